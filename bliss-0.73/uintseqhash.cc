@@ -25,7 +25,7 @@ namespace bliss {
  * Random bits generated by
  * http://www.fourmilab.ch/hotbits/
  */
-static unsigned int rtab[256] = {
+static const unsigned int rtab[256] = {
   0xAEAA35B8, 0x65632E16, 0x155EDBA9, 0x01349B39,
   0x8EB8BD97, 0x8E4C5367, 0x8EA78B35, 0x2B1B4072,
   0xC1163893, 0x269A8642, 0xC79D7F6D, 0x6A32DEA0,
@@ -0,0 +1,130 @@
+#include <fstream>
+#include <algorithm>
+#include <sstream>
+#include <stdio.h>
+#include "catalogue.h"
+
+MotifCatalogue::MotifCatalogue()
+  : ids(),
+    motifs()
+{}
+
+void MotifCatalogue::add(const EventSeq& seq)
+{
+  std::pair<IdMap::iterator, bool> res = ids.insert(std::make_pair(seq, (unsigned int)motifs.size()));
+  if (res.second) motifs.push_back(res.first);
+}
+
+/* Extend 'seq' by all possible events until it has 'nof_events'
+   events. The nodes of each event are either old nodes or the next
+   new labels. */
+void MotifCatalogue::enumerate(EventSeq& seq, unsigned int nof_nodes, unsigned int nof_events)
+{
+  if (seq.size() == 2*nof_events)
+    {
+      // Add the motif if it is connected.
+      std::vector<unsigned int> comp(nof_nodes);
+      for (unsigned int i = 0; i < nof_nodes; ++i) comp[i] = i;
+      for (unsigned int i = 0; i < seq.size(); i += 2)
+	{
+	  unsigned int c_fr = comp[seq[i]], c_to = comp[seq[i+1]];
+	  for (unsigned int j = 0; j < nof_nodes; ++j) if (comp[j] == c_to) comp[j] = c_fr;
+	}
+      for (unsigned int i = 1; i < nof_nodes; ++i) if (comp[i] != comp[0]) return;
+      add(seq);
+      return;
+    }
+
+  for (unsigned int fr = 0; fr <= nof_nodes; ++fr)
+    {
+      unsigned int max_to = (fr == nof_nodes ? nof_nodes + 1 : nof_nodes);
+      for (unsigned int to = 0; to <= max_to; ++to)
+	{
+	  if (to == fr) continue;
+	  seq.push_back(fr);
+	  seq.push_back(to);
+	  enumerate(seq, std::max(nof_nodes, std::max(fr, to) + 1), nof_events);
+	  seq.resize(seq.size() - 2);
+	}
+    }
+}
+
+void MotifCatalogue::generate(unsigned int max_events)
+{
+  EventSeq seq;
+  for (unsigned int k = 1; k <= max_events; ++k) enumerate(seq, 0, k);
+}
+
+unsigned int MotifCatalogue::get_id(const MotifKey& labelled_key, MotifKey& signature)
+{
+  // The key is N c_0 ... c_{N-1} followed by (fr, to, type) of each
+  // event.
+  unsigned int N = labelled_key[0];
+  unsigned int k = (labelled_key.size() - N - 1)/3;
+  EventSeq seq(2*k);
+  signature.assign(labelled_key.begin() + 1, labelled_key.begin() + 1 + N);
+  for (unsigned int i = 0; i < k; ++i)
+    {
+      seq[2*i] = labelled_key[N + 1 + 3*i];
+      seq[2*i+1] = labelled_key[N + 2 + 3*i];
+      signature.push_back(labelled_key[N + 3 + 3*i]);
+    }
+
+  IdMap::const_iterator it = ids.find(seq);
+  if (it != ids.end()) return it->second;
+  add(seq);
+  return motifs.size() - 1;
+}
+
+bool MotifCatalogue::read(std::istream& input)
+{
+  std::string line;
+  while (std::getline(input, line))
+    {
+      std::istringstream line_stream(line);
+      unsigned int id, fr, to;
+      char sep;
+      if (!(line_stream >> id) || id != motifs.size()) return false;
+      EventSeq seq;
+      while (line_stream >> fr >> sep >> to)
+	{
+	  if (sep != ',' || fr == to || fr > 65535 || to > 65535) return false;
+	  seq.push_back(fr);
+	  seq.push_back(to);
+	}
+      if (seq.empty()) return false;
+      add(seq);
+      if (motifs.size() != id + 1) return false; // Duplicate motif.
+    }
+  return true;
+}
+
+bool MotifCatalogue::write(const std::string& fileName) const
+{
+  std::ofstream output;
+  output.open(fileName.c_str());
+  if (output.fail())
+    {
+      perror("Failed to open catalogue file");
+      return false;
+    }
+
+  for (unsigned int id = 0; id < motifs.size(); ++id)
+    {
+      const EventSeq& seq = motifs[id]->first;
+      output << id;
+      for (unsigned int i = 0; i < seq.size(); i += 2)
+	{
+	  output << " " << (unsigned int)seq[i] << "," << (unsigned int)seq[i+1];
+	}
+      output << "\n";
+    }
+
+  output.close();
+  if (output.fail())
+    {
+      perror("Failed to close catalogue file");
+      return false;
+    }
+  return true;
+}
@@ -0,0 +1,64 @@
+/*
+Catalogue of untyped temporal motifs with dense integer ids.
+
+An untyped temporal motif is given by its event sequence when the
+nodes are labelled in the order of first appearance (see
+TSubgraph::get_labelled_key()), for example '0,1 1,2 0,1'. The
+catalogue enumerates all connected motifs with at most a given number
+of events and numbers them 0, 1, 2, ... in order of the number of
+events and then lexicographically. There are 1, 6, 68, 1240, 32272
+and 1115040 motifs with 1 to 6 events. Larger motifs get the next
+free id when they are first seen.
+
+The catalogue can be written into a file and read back, so that the
+same motif keeps its id in all runs that use the file. Each line of
+the file has the id and the event sequence of one motif.
+*/
+
+#ifndef CATALOGUE_H
+#define CATALOGUE_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <iostream>
+#include "tsubgraph.h"
+
+class MotifCatalogue
+{
+ private:
+  // Event sequence of an untyped motif: fr_1 to_1 fr_2 to_2 ...
+  typedef std::vector<unsigned short int> EventSeq;
+  typedef std::map<EventSeq, unsigned int> IdMap;
+
+  IdMap ids;
+  std::vector<IdMap::const_iterator> motifs; // Motifs by id.
+
+  void add(const EventSeq& seq);
+  void enumerate(EventSeq& seq, unsigned int nof_nodes, unsigned int nof_events);
+
+ public:
+  MotifCatalogue();
+
+  /* Add all connected motifs with at most 'max_events' events that
+     are not yet in the catalogue. */
+  void generate(unsigned int max_events);
+
+  /* Get the id of the untyped motif of 'labelled_key' (as given by
+     TSubgraph::get_labelled_key()), adding the motif if it is not
+     in the catalogue. The node and event colors of the key are saved
+     in 'signature', so that the id and the signature together
+     identify the typed motif. */
+  unsigned int get_id(const MotifKey& labelled_key, MotifKey& signature);
+
+  inline unsigned int size() const { return motifs.size(); };
+
+  /* Read the motifs from 'input'. The ids must be 0, 1, 2, ... in
+     this order. Returns false if the input is malformed. */
+  bool read(std::istream& input);
+
+  /* Write the catalogue into a file. */
+  bool write(const std::string& fileName) const;
+};
+
+#endif
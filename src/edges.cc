@@ -1,36 +1,45 @@
 #include "edges.h"
 
+unsigned int Edge::_node_bits = 24;
+unsigned int Edge::_type_bits = 16;
+uint64_t Edge::node_mask = (((uint64_t)1) << 24) - 1;
+uint64_t Edge::type_mask = (((uint64_t)1) << 16) - 1;
+int Edge::type_min = std::numeric_limits<short int>::min();
+
 Edge::Edge():
-  from(0),
-  to(0),
-  type(-1)
+  _bits(0) // Nodes 0 and the smallest type.
 {}
 
 Edge::Edge(const Event& event):
-  from(event.from()),
-  to(event.to()),
-  type(event.type())
+  _bits(((uint64_t)event.from() << (_node_bits + _type_bits)) |
+	((uint64_t)event.to() << _type_bits) |
+	((uint64_t)(event.type() - type_min) & type_mask))
 {}
 
 Edge::Edge(node_id from, node_id to, short int type):
-  from(from),
-  to(to),
-  type(type)
+  _bits(((uint64_t)from << (_node_bits + _type_bits)) |
+	((uint64_t)to << _type_bits) |
+	((uint64_t)(type - type_min) & type_mask))
 {}
 
-bool operator<(const Edge& e1, const Edge& e2)
+bool Edge::set_range(node_id max_node, short int min_type, short int max_type)
 {
-  if (e1.from == e2.from)
-    {
-      if (e1.to == e2.to) return e1.type < e2.type;
-      return e1.to < e2.to;
-    }
-  return e1.from < e2.from; 
+  unsigned int type_bits = 0;
+  while (type_bits < 16 && (max_type - min_type) >> type_bits) type_bits++;
+  unsigned int node_bits = (64 - type_bits)/2;
+  if (node_bits < 32 && (max_node >> node_bits)) return false;
+
+  _node_bits = node_bits;
+  _type_bits = 64 - 2*node_bits;
+  node_mask = (((uint64_t)1) << node_bits) - 1;
+  type_mask = (((uint64_t)1) << _type_bits) - 1;
+  type_min = min_type;
+  return true;
 }
 
 std::ostream& operator<<(std::ostream& output, const Edge& e)
 {
-  output << e.from << "->" << e.to << ":" << e.type;
+  output << e.from() << "->" << e.to() << ":" << e.type();
   return output;
 }
 
@@ -9,22 +9,54 @@
 #include <map>
 #include "events.h"
 
-struct Edge
-{ 
-  node_id from;
-  node_id to;
-  short int type;
+/* Edge with an event type, packed into a single 64-bit word. The
+   source node is in the highest bits, then the target node and then
+   the type (minus the smallest type, so that it is non-negative), so
+   that comparing the words orders the edges by source, target and
+   type.
+
+   The number of bits for the nodes and for the type is chosen at run
+   time with set_range() from the largest node id and the range of
+   types in the data. Until then 24 bits are used for each node and 16
+   bits for the type (the whole range of short int). */
+class Edge
+{
+ private:
+  static unsigned int _node_bits;
+  static unsigned int _type_bits;
+  static uint64_t node_mask;
+  static uint64_t type_mask;
+  static int type_min;
+
+  uint64_t _bits;
+
+ public:
   Edge();
   Edge(const Event& event);
   Edge(node_id from, node_id to, short int type);
-  friend bool operator<(const Edge& e1, const Edge& e2);
+
+  inline node_id from() const { return (node_id)(_bits >> (_node_bits + _type_bits)); };
+  inline node_id to() const { return (node_id)((_bits >> _type_bits) & node_mask); };
+  inline short int type() const { return (short int)((int)(_bits & type_mask) + type_min); };
+
+  /* The packed word, for hashing. */
+  inline uint64_t bits() const { return _bits; };
+
+  /* Choose the number of bits so that node ids up to 'max_node' and
+     types from 'min_type' to 'max_type' fit into a packed edge. The
+     nodes get all bits that the types do not need. Returns false if
+     they do not fit into 64 bits. Must be called before constructing
+     any edges, and not while other threads use edges. */
+  static bool set_range(node_id max_node, short int min_type, short int max_type);
+  static inline unsigned int node_bits() { return _node_bits; };
+  static inline unsigned int type_bits() { return _type_bits; };
+
+  friend bool operator<(const Edge& e1, const Edge& e2) { return e1._bits < e2._bits; };
+  friend bool operator==(const Edge& e1, const Edge& e2) { return e1._bits == e2._bits; };
 };
 typedef std::vector<Edge> EdgeVector;
 typedef std::set<Edge> EdgeSet;
-typedef std::map<EdgeVector, unsigned int> EdgeVectorMap;
-//typedef std::map<unsigned int, EdgeVectorMap> LocationMap;
 
-bool operator<(const Edge& e1, const Edge& e2);
 std::ostream& operator<<(std::ostream& output, const Edge& e);
 
 typedef std::vector<std::pair<node_id, node_id> > NodepairVector;
@@ -3,10 +3,15 @@
  * Lauri Kovanen, BECS (June 2010)
  */
 #include <iostream>
+#include <stdio.h>
 #include <math.h>
+#include <queue>
+#include <functional>
 #include "events.h"
+#include "progress_counter.h"
 
 const event_id Event::null_event = std::numeric_limits<event_id>::max();
+const unsigned char ComponentHierarchy::never_merged = std::numeric_limits<unsigned char>::max();
 
 void Event::Init(event_id id, node_id fr, node_id to,
 		 unsigned int start_time, unsigned int duration,
@@ -514,7 +519,8 @@ void Events::print() const
 
 
 
-void Events::next_immediate_events(event_id e_id, EventMMap& next_events) const
+template <class EventMap>
+void Events::next_immediate_events(event_id e_id, EventMap& next_events) const
 {
   const Event& e = events[e_id];
 
@@ -572,7 +578,8 @@ void Events::next_immediate_events(event_id e_id, EventMMap& next_events) const
   return;
 }
 
-void Events::prev_immediate_events(event_id e_id, EventMMap& prev_events) const
+template <class EventMap>
+void Events::prev_immediate_events(event_id e_id, EventMap& prev_events) const
 {
   const Event& e = events[e_id];
   node_id node = e.from();
@@ -630,6 +637,11 @@ void Events::prev_immediate_events(event_id e_id, EventMMap& prev_events) const
   return;
 }
 
+template void Events::next_immediate_events<EventMMap>(event_id, EventMMap&) const;
+template void Events::prev_immediate_events<EventMMap>(event_id, EventMMap&) const;
+template void Events::next_immediate_events<ImmediateEvents>(event_id, ImmediateEvents&) const;
+template void Events::prev_immediate_events<ImmediateEvents>(event_id, ImmediateEvents&) const;
+
 void Events::check_events() const
 {
   // Go through all events and make sure that the event is listed for
@@ -672,43 +684,314 @@ void Events::check_events() const
     }
 }
 
-void Events::find_maximal_subgraphs(unsigned int tw)
+event_id Events::find_root(event_id i)
+{
+  // Find the root with path halving: every other event on the path
+  // is made to point to its grandparent.
+  while (events[i].component() != i)
+    {
+      event_id parent = events[i].component();
+      events[i].set_component(events[parent].component());
+      i = events[i].component();
+    }
+  return i;
+}
+
+void Events::join(event_id i, event_id j)
+{
+  i = find_root(i);
+  j = find_root(j);
+  // The smaller id always becomes the root, so that the root is the
+  // earliest event of the component.
+  if (i < j) events[j].set_component(i);
+  else if (j < i) events[i].set_component(j);
+}
+
+void Events::label_segment(event_id first, event_id last, unsigned int tw,
+			   std::vector<std::pair<event_id, event_id> >& crossing)
+{
+  // Join each event with the previous event of both of its nodes if
+  // the time difference is at most tw. The component id of each event
+  // is used as the parent pointer of a union-find structure. Two
+  // events that are adjacent through a third event (see
+  // next_immediate_events()) are always also joined through it, so
+  // the components are the same as those obtained by following the
+  // immediate events. Pairs where the previous event is in an earlier
+  // segment are only saved, because the earlier segment may be
+  // processed at the same time.
+  for (event_id i = first; i < last; ++i)
+    {
+      Event& e = events[i];
+      e.set_component(i);
+
+      node_id node = e.from();
+      for (int i_node = 0; i_node < 2; ++i_node)
+	{
+	  node_iterator it = find_node_event(node, i); it--;
+	  if (it != rend(node) && dt(*it, i) <= tw)
+	    {
+	      if (*it >= first) join(*it, i);
+	      else crossing.push_back(std::make_pair(*it, i));
+	    }
+	  node = e.to(); // Repeat for the other node.
+	}
+    }
+}
+
+void Events::find_maximal_subgraphs(unsigned int tw, ComponentStats* stats)
+{
+  // Split the events into time segments that are labelled in
+  // parallel. Each segment only touches the parent pointers of its
+  // own events.
+  unsigned int N_segments = 1;
+#ifdef _OPENMP
+  N_segments = omp_get_max_threads();
+#endif
+  if (N_segments > size()) N_segments = 1;
+  std::vector<std::vector<std::pair<event_id, event_id> > > crossing(N_segments);
+
+#pragma omp parallel for schedule(static, 1)
+  for (int i_seg = 0; i_seg < (int)N_segments; ++i_seg)
+    {
+      event_id first = (event_id)(((uint64_t)size()*i_seg)/N_segments);
+      event_id last = (event_id)(((uint64_t)size()*(i_seg+1))/N_segments);
+      label_segment(first, last, tw, crossing[i_seg]);
+    }
+
+  // Stitch together the components that continue over segment
+  // boundaries.
+  for (unsigned int i_seg = 0; i_seg < N_segments; ++i_seg)
+    {
+      std::vector<std::pair<event_id, event_id> >::const_iterator it;
+      for (it = crossing[i_seg].begin(); it != crossing[i_seg].end(); ++it)
+	{
+	  join(it->first, it->second);
+	}
+    }
+
+  // The parent of each event is always an earlier event, so a single
+  // pass in temporal order replaces the parents by the roots. The
+  // maximal subgraph id is thus the id of the earliest event in the
+  // subgraph.
+  for (iterator e_it = begin(); e_it != end(); ++e_it)
+    {
+      e_it->set_component(events[e_it->component()].component());
+    }
+
+  if (stats) component_statistics(*stats);
+}
+
+void Events::component_statistics(ComponentStats& stats) const
 {
-  // Go through all events and recursively find the maximal temporal
-  // subgraph. The maximal subgraph id will be the event id of the
-  // earliest id in the subgraph (this happens implicitely because we
-  // go through the events in temporal order).
-  iterator e_it;
-  for (e_it = begin(); e_it != end(); ++e_it)
+  stats.sizes.clear();
+  stats.nodes.clear();
+  stats.durations.clear();
+
+  // Sort the events by component with counting sort. After this the
+  // events of component 'c' are order[first[c]], ...,
+  // order[first[c+1]-1].
+  std::vector<event_id> first(size()+1, 0);
+  for (const_iterator e_it = begin(); e_it != end(); ++e_it) first[e_it->component()+1]++;
+  for (event_id c = 0; c < size(); ++c) first[c+1] += first[c];
+  std::vector<event_id> order(size());
+  std::vector<event_id> pos(first.begin(), first.end()-1);
+  for (const_iterator e_it = begin(); e_it != end(); ++e_it) order[pos[e_it->component()]++] = e_it->id();
+  std::vector<event_id>().swap(pos);
+
+  // Go through the components one by one, marking the nodes already
+  // seen with the component id.
+  std::vector<event_id> node_mark(get_nof_nodes(), Event::null_event);
+  for (event_id c = 0; c < size(); ++c)
     {
-      // See if this event has already been assigned to a temporal
-      // component.
-      if (e_it->has_component()) continue;
+      if (first[c] == first[c+1]) continue;
+      unsigned int n_nodes = 0;
+      unsigned int t_end = 0;
+      for (event_id k = first[c]; k < first[c+1]; ++k)
+	{
+	  const Event& e = events[order[k]];
+	  if (node_mark[e.from()] != c) { node_mark[e.from()] = c; n_nodes++; }
+	  if (node_mark[e.to()] != c) { node_mark[e.to()] = c; n_nodes++; }
+	  if (e.end_time() > t_end) t_end = e.end_time();
+	}
+      unsigned int duration = t_end - events[c].start_time();
+      unsigned int d_bin = 0;
+      if (duration) for (d_bin = 1; d_bin <= duration/2; d_bin *= 2);
 
-      unsigned int component_id = e_it->id();
-      std::set<event_id> to_process;
-      to_process.insert(component_id);
+      stats.sizes[first[c+1]-first[c]]++;
+      stats.nodes[n_nodes]++;
+      stats.durations[d_bin]++;
+    }
+}
 
-      while (!to_process.empty())
+void Events::find_maximal_subgraphs(const std::vector<unsigned int>& tws,
+				    ComponentHierarchy& ch) const
+{
+  ch.tws.assign(tws.begin(), tws.end());
+  std::sort(ch.tws.begin(), ch.tws.end());
+  ch.tws.erase(std::unique(ch.tws.begin(), ch.tws.end()), ch.tws.end());
+  assert(ch.tws.size() < ComponentHierarchy::never_merged);
+  unsigned int N_tws = ch.tws.size();
+
+  // Collect the pairs of consecutive events of each node, grouped by
+  // the smallest time window with which they are joined. Pairs with
+  // time difference larger than all time windows are dropped.
+  std::vector<std::vector<std::pair<event_id, event_id> > > joins(N_tws);
+  std::vector<event_id> last_event(get_nof_nodes(), Event::null_event);
+  for (const_iterator e_it = begin(); e_it != end(); ++e_it)
+    {
+      event_id i = e_it->id();
+      node_id node = e_it->from();
+      for (int i_node = 0; i_node < 2; ++i_node)
 	{
-	  // Take an event from processing queue and set its component
-	  // id.
-	  std::set<event_id>::iterator it = to_process.begin();
-	  Event& e = events[*it];
-	  e.set_component(component_id);
-	  to_process.erase(it);
-
-	  // Add immediate neighbors of this event to queue, unless
-	  // they already have a community id (which shows that they
-	  // have already been processed).
-	  EventMMap neighbors;
-	  prev_immediate_events(e.id(), neighbors);
-	  next_immediate_events(e.id(), neighbors);
-	  for (EventMMap::const_iterator it = neighbors.begin(); it != neighbors.end(); it++)
+	  event_id prev = last_event[node];
+	  if (prev != Event::null_event)
 	    {
-	      if (it->first > tw) break;
-	      if (!events[it->second].has_component()) to_process.insert(it->second);
+	      unsigned int level = std::lower_bound(ch.tws.begin(), ch.tws.end(), dt(prev, i)) - ch.tws.begin();
+	      if (level < N_tws) joins[level].push_back(std::make_pair(prev, i));
 	    }
+	  last_event[node] = i;
+	  node = e_it->to(); // Repeat for the other node.
 	}
     }
+
+  // Join the pairs in order of increasing time window, like in
+  // Kruskal's algorithm. The smaller id is always the root.
+  std::vector<event_id> parent(size());
+  for (event_id i = 0; i < size(); ++i) parent[i] = i;
+  ch.merged_into.assign(size(), Event::null_event);
+  ch.merge_level.assign(size(), ComponentHierarchy::never_merged);
+  ch.base.resize(size());
+  for (unsigned int level = 0; level < N_tws; ++level)
+    {
+      std::vector<event_id> merged;
+      std::vector<std::pair<event_id, event_id> >::const_iterator it;
+      for (it = joins[level].begin(); it != joins[level].end(); ++it)
+	{
+	  event_id r1 = it->first, r2 = it->second;
+	  while (parent[r1] != r1) r1 = parent[r1] = parent[parent[r1]];
+	  while (parent[r2] != r2) r2 = parent[r2] = parent[parent[r2]];
+	  if (r1 == r2) continue;
+	  if (r2 < r1) std::swap(r1, r2);
+	  parent[r2] = r1;
+	  ch.merge_level[r2] = level;
+	  merged.push_back(r2);
+	}
+      std::vector<std::pair<event_id, event_id> >().swap(joins[level]);
+
+      // Point the components merged at this level directly to the
+      // root at the end of the level, so that component() takes at
+      // most one step per time window.
+      for (std::vector<event_id>::const_iterator m_it = merged.begin(); m_it != merged.end(); ++m_it)
+	{
+	  event_id r = *m_it;
+	  while (parent[r] != r) r = parent[r];
+	  ch.merged_into[*m_it] = r;
+	}
+
+      // The parent of each event is always an earlier event, so a
+      // single pass gives the components with the smallest time
+      // window.
+      if (level == 0)
+	{
+	  for (event_id i = 0; i < size(); ++i) ch.base[i] = (parent[i] == i ? i : ch.base[parent[i]]);
+	}
+    }
+  if (N_tws == 0) ch.base = parent;
+}
+
+void Events::set_components(const ComponentHierarchy& ch, unsigned int i_tw)
+{
+  for (iterator e_it = begin(); e_it != end(); ++e_it)
+    {
+      e_it->set_component(ch.component(e_it->id(), i_tw));
+    }
+}
+
+/* Maximal subgraph that may still get new events. */
+struct OpenSubgraph
+{
+  unsigned int t_end;  // Largest end time of the events so far.
+  unsigned int size;   // Number of events so far.
+  std::set<event_id> eventSet; // Emptied when the subgraph becomes too large.
+  OpenSubgraph() : t_end(0), size(0), eventSet() {};
+};
+
+void Events::stream_maximal_subgraphs(unsigned int tw, unsigned int max_size,
+				      unsigned int t_start, unsigned int t_stop,
+				      MaximalSubgraphVisitor& visitor,
+				      ProgressCounter* progress) const
+{
+  // The events of a maximal subgraph are collected while going
+  // through the events in temporal order. Closing times are kept in
+  // a queue; an entry is out of date if the subgraph has got new
+  // events after it was added.
+  typedef std::map<event_id, OpenSubgraph> OpenSubgraphMap;
+  typedef std::pair<unsigned int, event_id> ClosingTime;
+  OpenSubgraphMap open_subgraphs;
+  std::priority_queue<ClosingTime, std::vector<ClosingTime>, std::greater<ClosingTime> > closing_times;
+
+  const_iterator e_it = begin();
+  while (!open_subgraphs.empty() || e_it != end())
+    {
+      // Skip the events before t_start and stop adding events after
+      // t_stop.
+      if (e_it != end() && e_it->start_time() < t_start) { ++e_it; continue; }
+      if (e_it != end() && e_it->start_time() > t_stop) e_it = end();
+
+      // Hand over all maximal subgraphs that have been closed (all of
+      // them after the last event).
+      while (!closing_times.empty() &&
+	     (e_it == end() || closing_times.top().first < e_it->start_time()))
+	{
+	  OpenSubgraphMap::iterator os_it = open_subgraphs.find(closing_times.top().second);
+	  unsigned int t_close = closing_times.top().first;
+	  closing_times.pop();
+	  if (os_it == open_subgraphs.end() || os_it->second.t_end + tw != t_close) continue;
+	  visitor.visit(os_it->first, os_it->second.size, os_it->second.eventSet);
+	  open_subgraphs.erase(os_it);
+	}
+      if (e_it == end()) continue;
+
+      if (progress) progress->next(*e_it);
+
+      // Add event to the maximal subgraph. Only the number of events
+      // is kept once the maximal subgraph is too large.
+      OpenSubgraph& os = open_subgraphs[e_it->component()];
+      os.size++;
+      if (!max_size || os.size <= max_size) os.eventSet.insert(os.eventSet.end(), e_it->id());
+      else if (!os.eventSet.empty()) os.eventSet.clear();
+      if (os.size == 1 || e_it->end_time() > os.t_end)
+	{
+	  os.t_end = std::max(os.t_end, e_it->end_time());
+	  closing_times.push(std::make_pair(os.t_end + tw, e_it->component()));
+	}
+      ++e_it;
+    }
+}
+
+bool ComponentStats::print(const std::string& fileName) const
+{
+  std::ofstream output;
+  output.open(fileName.c_str());
+  if (output.fail())
+    {
+      perror("Failed to open output file");
+      return false;
+    }
+
+  std::map<unsigned int, unsigned int>::const_iterator it;
+  output << "# N_events count" << std::endl;
+  for (it = sizes.begin(); it != sizes.end(); ++it) output << it->first << " " << it->second << std::endl;
+  output << std::endl << "# N_nodes count" << std::endl;
+  for (it = nodes.begin(); it != nodes.end(); ++it) output << it->first << " " << it->second << std::endl;
+  output << std::endl << "# duration count" << std::endl;
+  for (it = durations.begin(); it != durations.end(); ++it) output << it->first << " " << it->second << std::endl;
+
+  output.close();
+  if (output.fail())
+    {
+      perror("Failed to close output file");
+      return false;
+    }
+  return true;
 }
@@ -19,6 +19,10 @@
 #include <cstdlib>
 #include <stdint.h>
 #include <math.h>
+#include <fstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "fixed_tree.h"
 #include "std_printers.h"
 
@@ -28,7 +32,38 @@ typedef FixedTree<event_id> event_tree;
 typedef event_tree::iterator node_iterator;
 typedef std::multimap<unsigned int, event_id> EventMMap;
 
+/* Fixed-size replacement of EventMMap for the immediate events of a
+   single event (at most two previous and two next events). Pairs are
+   kept ordered by the time difference, and a new pair is placed after
+   pairs with the same time difference just like in
+   std::multimap::insert(). */
+class ImmediateEvents
+{
+ public:
+  typedef std::pair<unsigned int, event_id> value_type;
+  typedef const value_type* const_iterator;
+
+ private:
+  value_type values[4];
+  unsigned int n;
+
+ public:
+  ImmediateEvents() : n(0) {};
+  inline void insert(const value_type& v)
+  {
+    assert(n < 4);
+    unsigned int i = n++;
+    for (; i > 0 && v.first < values[i-1].first; --i) values[i] = values[i-1];
+    values[i] = v;
+  };
+  inline unsigned int size() const { return n; };
+  inline void clear() { n = 0; };
+  inline const_iterator begin() const { return values; };
+  inline const_iterator end() const { return values+n; };
+};
+
 class Events;
+class ProgressCounter;
 
 class Event
 {
@@ -79,6 +114,72 @@ class Event
 
 std::ostream& operator<<(std::ostream& output, const Event& e);
 
+/* Maximal subgraph ids for several time windows at once. Because the
+   maximal subgraphs with a time window are unions of those with a
+   smaller time window, the ids are saved as a hierarchy: the id with
+   the smallest time window for each event, and for each maximal
+   subgraph the larger subgraph it is merged into and the index of
+   the time window at which this happens.
+*/
+class ComponentHierarchy
+{
+  friend class Events;
+ private:
+  static const unsigned char never_merged;
+
+  std::vector<unsigned int> tws; // Time windows in increasing order.
+  std::vector<event_id> base; // Component id with the smallest time window.
+  std::vector<event_id> merged_into;
+  std::vector<unsigned char> merge_level;
+
+ public:
+  inline unsigned int size() const { return tws.size(); };
+  inline unsigned int time_window(unsigned int i_tw) const { return tws[i_tw]; };
+
+  /* Return the component id of event 'i' with the time window
+     time_window(i_tw). The id is found in at most size() steps. */
+  inline event_id component(event_id i, unsigned int i_tw) const
+  {
+    event_id c = base[i];
+    while (merge_level[c] <= i_tw) c = merged_into[c];
+    return c;
+  };
+};
+
+/* Distributions of the number of events, the number of nodes and the
+   duration of maximal subgraphs. The durations are binned
+   logarithmically: bin 'd' contains durations from d to 2*d-1.
+*/
+struct ComponentStats
+{
+  std::map<unsigned int, unsigned int> sizes;
+  std::map<unsigned int, unsigned int> nodes;
+  std::map<unsigned int, unsigned int> durations;
+
+  inline unsigned int nof_components() const
+  {
+    unsigned int n = 0;
+    std::map<unsigned int, unsigned int>::const_iterator it;
+    for (it = sizes.begin(); it != sizes.end(); ++it) n += it->second;
+    return n;
+  };
+
+  // Write the three distributions into a file.
+  bool print(const std::string& fileName) const;
+};
+
+/* Receives the maximal subgraphs found by
+   Events::stream_maximal_subgraphs(). */
+class MaximalSubgraphVisitor
+{
+ public:
+  /* 'component' is the id of the maximal subgraph and 'size' the
+     number of its events. 'eventSet' has the events, or is empty if
+     there are more of them than the given maximum. */
+  virtual void visit(event_id component, unsigned int size, const std::set<event_id>& eventSet) =0;
+  virtual ~MaximalSubgraphVisitor() {};
+};
+
 class Events
 {
  private:
@@ -106,6 +207,18 @@ class Events
    */
   bool check_overlap(event_id i_first, event_id i_second);
 
+  /* Union-find operations for finding maximal subgraphs. The
+     component id of each event is used as the parent pointer. */
+  event_id find_root(event_id i);
+  void join(event_id i, event_id j);
+
+  /* Label the events first, ..., last-1. The pairs of events to join
+     where the first event is before this segment are saved in
+     'crossing'.
+  */
+  void label_segment(event_id first, event_id last, unsigned int tw,
+		     std::vector<std::pair<event_id, event_id> >& crossing);
+
  public:
 
   inline unsigned int size() const {return events.size();};
@@ -182,6 +295,7 @@ class Events
   inline node_iterator end(node_id node) const {return node_events[node].end(); };
   inline node_iterator rbegin(node_id node) const {return node_events[node].rbegin(); };
   inline node_iterator rend(node_id node) const {return node_events[node].rend(); };
+  inline unsigned int nof_node_events(node_id node) const { return node_events[node].size(); };
 
   /* Interface for iterating through all events. (This is just a
      shortcut to iterating through the events list.) */
@@ -192,15 +306,49 @@ class Events
   inline const_iterator begin() const {return events.begin();};
   inline const_iterator end() const {return events.end();};
 
-  /* Get the immediate next and previous events.
+  /* Get the immediate next and previous events. The result type
+     can be either EventMMap or ImmediateEvents.
   */
-  void next_immediate_events(event_id e_id, EventMMap& next_events) const;
-  void prev_immediate_events(event_id e_id, EventMMap& prev_events) const;
+  template <class EventMap> void next_immediate_events(event_id e_id, EventMap& next_events) const;
+  template <class EventMap> void prev_immediate_events(event_id e_id, EventMap& prev_events) const;
 
   /* Identify maximal subgraphs with given time window. The ID of
-     maximal subgraphs is set as the component id of each event.
+     maximal subgraphs is set as the component id of each event. The
+     events are labelled in parallel in time segments when compiled
+     with OpenMP. If 'stats' is given, it is filled with the
+     distributions of maximal subgraph sizes.
+  */
+  void find_maximal_subgraphs(unsigned int tw, ComponentStats* stats = NULL);
+
+  /* Fill in the distributions of maximal subgraph sizes. The
+     component ids must have been set. */
+  void component_statistics(ComponentStats& stats) const;
+
+  /* Identify maximal subgraphs with all given time windows in a
+     single pass. The time windows are sorted and duplicates removed;
+     at most 254 time windows can be used. This method does not change
+     the component ids of events; use set_components() for that.
+  */
+  void find_maximal_subgraphs(const std::vector<unsigned int>& tws,
+			      ComponentHierarchy& ch) const;
+
+  /* Set the component id of each event to that with the time window
+     ch.time_window(i_tw). */
+  void set_components(const ComponentHierarchy& ch, unsigned int i_tw);
+
+  /* Go through the maximal subgraphs (given by the component ids
+     found with time window 'tw') of the events that start from
+     't_start' to 't_stop', in temporal order. Only the subgraphs that
+     may still get new events are kept: each subgraph is handed to
+     'visitor' as soon as the current time is more than 'tw' after the
+     end of its latest event. The events are kept only for subgraphs
+     with at most 'max_size' events (0 means no limit). If 'progress'
+     is given, it is advanced for each event.
   */
-  void find_maximal_subgraphs(unsigned int tw);
+  void stream_maximal_subgraphs(unsigned int tw, unsigned int max_size,
+				unsigned int t_start, unsigned int t_stop,
+				MaximalSubgraphVisitor& visitor,
+				ProgressCounter* progress = NULL) const;
 };
 
 
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include "location_map.h"
+
+LocationMap::LocationMap()
+  : keys(),
+    offsets(1, 0),
+    hashes(),
+    counts(),
+    slots()
+{}
+
+unsigned int LocationMap::hash(const Edge* edges, size_t n)
+{
+  // Multiply and xor-shift each packed edge into a 64-bit state, so
+  // that the low bits used for the slot depend on all bits of the
+  // edges.
+  unsigned long long int h = n;
+  for (size_t i = 0; i < n; ++i)
+    {
+      h = (h ^ edges[i].bits())*0x9E3779B97F4A7C15ULL;
+      h ^= h >> 29;
+    }
+  return (unsigned int)(h ^ (h >> 32));
+}
+
+long LocationMap::find(const Edge* edges, size_t n, unsigned int h) const
+{
+  if (slots.empty()) return -1;
+  size_t mask = slots.size() - 1;
+  for (size_t i_slot = h & mask; slots[i_slot]; i_slot = (i_slot + 1) & mask)
+    {
+      unsigned int i = slots[i_slot] - 1;
+      if (hashes[i] == h && offsets[i+1] - offsets[i] == n &&
+	  std::equal(edges, edges + n, keys.begin() + offsets[i])) return i;
+    }
+  return -1;
+}
+
+unsigned int& LocationMap::get(const Edge* edges, size_t n, unsigned int h)
+{
+  // Keep the table at most half full.
+  if (2*(counts.size() + 1) > slots.size()) grow();
+  size_t mask = slots.size() - 1;
+  size_t i_slot = h & mask;
+  for (; slots[i_slot]; i_slot = (i_slot + 1) & mask)
+    {
+      unsigned int i = slots[i_slot] - 1;
+      if (hashes[i] == h && offsets[i+1] - offsets[i] == n &&
+	  std::equal(edges, edges + n, keys.begin() + offsets[i])) return counts[i];
+    }
+
+  // Add the location to the empty slot.
+  keys.insert(keys.end(), edges, edges + n);
+  offsets.push_back(keys.size());
+  hashes.push_back(h);
+  counts.push_back(0);
+  slots[i_slot] = counts.size();
+  return counts.back();
+}
+
+void LocationMap::grow()
+{
+  std::vector<unsigned int> new_slots(slots.empty() ? 16 : 2*slots.size(), 0);
+  size_t mask = new_slots.size() - 1;
+  for (unsigned int i = 0; i < counts.size(); ++i)
+    {
+      size_t i_slot = hashes[i] & mask;
+      while (new_slots[i_slot]) i_slot = (i_slot + 1) & mask;
+      new_slots[i_slot] = i + 1;
+    }
+  slots.swap(new_slots);
+}
+
+unsigned int& LocationMap::operator[](const EdgeVector& edges)
+{
+  const Edge* first = (edges.empty() ? NULL : &edges[0]);
+  return get(first, edges.size(), hash(first, edges.size()));
+}
+
+unsigned int LocationMap::get_count(const EdgeVector& edges) const
+{
+  const Edge* first = (edges.empty() ? NULL : &edges[0]);
+  long i = find(first, edges.size(), hash(first, edges.size()));
+  return (i < 0 ? 0 : counts[i]);
+}
+
+void LocationMap::add(const LocationMap& other)
+{
+  // The edges and hashes are taken from 'other' as they are.
+  for (size_t i = 0; i < other.size(); ++i)
+    {
+      size_t n = other.offsets[i+1] - other.offsets[i];
+      const Edge* first = (n ? &other.keys[other.offsets[i]] : NULL);
+      get(first, n, other.hashes[i]) += other.counts[i];
+    }
+}
+
+void LocationMap::get_edges(size_t i, EdgeVector& edges) const
+{
+  edges.assign(keys.begin() + offsets[i], keys.begin() + offsets[i+1]);
+}
+
+void LocationMap::clear()
+{
+  keys.clear();
+  offsets.assign(1, 0);
+  hashes.clear();
+  counts.clear();
+  slots.clear();
+}
+
+void LocationMap::swap(LocationMap& other)
+{
+  keys.swap(other.keys);
+  offsets.swap(other.offsets);
+  hashes.swap(other.hashes);
+  counts.swap(other.counts);
+  slots.swap(other.slots);
+}
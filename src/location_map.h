@@ -0,0 +1,75 @@
+/*
+Number of subgraphs at each location.
+
+A location is an edge sequence (the edges of the events of a subgraph
+in temporal order, with event types). There can be hundreds of
+millions of them, so instead of a tree of vectors the map is a flat
+open addressing hash table:
+
+ - the edges of all locations (64 bits each, see Edge) are kept one
+   after another in a single array, in the order the locations were
+   added,
+ - the hash of each location is computed once and saved, so that
+   growing the table does not read the edges again and most failed
+   comparisons are decided by the hash alone,
+ - the table itself only holds the index of the location in each
+   slot, and collisions are resolved by linear probing.
+
+The locations are numbered 0, 1, 2, ... in the order they were added,
+and they are iterated through by this number. There can be at most
+2^32-1 locations.
+*/
+
+#ifndef LOCATION_MAP_H
+#define LOCATION_MAP_H
+
+#include <vector>
+#include "edges.h"
+
+class LocationMap
+{
+ private:
+  std::vector<Edge> keys;           // Edges of all locations.
+  std::vector<size_t> offsets;      // Location i has keys[offsets[i], offsets[i+1]).
+  std::vector<unsigned int> hashes; // Hash of each location.
+  std::vector<unsigned int> counts; // Count of each location.
+  std::vector<unsigned int> slots;  // Location index + 1 in each slot, 0 if empty.
+
+  static unsigned int hash(const Edge* edges, size_t n);
+
+  /* Get the count of the location with the given edges and hash,
+     adding the location if it does not exist. */
+  unsigned int& get(const Edge* edges, size_t n, unsigned int h);
+
+  /* Find the index of the location, or -1 if it does not exist. */
+  long find(const Edge* edges, size_t n, unsigned int h) const;
+
+  /* Double the number of slots (or create the first ones). */
+  void grow();
+
+ public:
+  LocationMap();
+
+  /* Get the count of the location given by 'edges', adding the
+     location with count 0 if it does not exist. The reference is
+     valid until the next location is added. */
+  unsigned int& operator[](const EdgeVector& edges);
+
+  /* Get the count of the location, 0 if it does not exist. */
+  unsigned int get_count(const EdgeVector& edges) const;
+
+  /* Add the counts of all locations of 'other'. */
+  void add(const LocationMap& other);
+
+  /* Number of locations and access to the i'th one. */
+  inline size_t size() const { return counts.size(); };
+  void get_edges(size_t i, EdgeVector& edges) const;
+  inline unsigned int count(size_t i) const { return counts[i]; };
+
+  /* Remove all locations. */
+  void clear();
+
+  void swap(LocationMap& other);
+};
+
+#endif
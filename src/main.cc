@@ -20,6 +20,10 @@ along with this program.  If not, see {http://www.gnu.org/licenses/}.
 #include <math.h>
 #include <time.h>
 #include <iterator>
+#include <queue>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "events.h"
 #include "tsubgraph.h"
 #include "subnets.h"
@@ -29,17 +33,25 @@ along with this program.  If not, see {http://www.gnu.org/licenses/}.
 #include "lcelib/Nets.H"
 #include "edges.h"
 #include "bin_limits.h"
+#include "sampling.h"
+#include "motif_cache.h"
+#include "catalogue.h"
+#include "location_map.h"
 
-// LocationMap[motif_hash][edge_id_list] = count
+// locationMap[edges] = count
 
-// weightsMap[motif_hash].add(weightVector, value)
-// weightsMap[motif_hash].get_mean(weightVector, result)
+// weightsMaps[motif_id][signature].add(weightVector, value)
+// weightsMaps[motif_id][signature].get_mean(weightVector, result)
 typedef Binner<unsigned int> wBinner;
 typedef std::vector<unsigned int> WeightVector;
-typedef std::map<unsigned int, wBinner> WeightsMap;
+typedef std::map<MotifKey, wBinner> WeightsMap;
 
 typedef DirNet<unsigned int> NetType;
 
+/* Maximum number of motifs kept in each motif cache. This is a number
+   of motifs, not of bytes; see MotifCache. */
+const size_t motif_cache_size = 100000;
+
 typedef std::vector<short int> TypeSeq;
 typedef std::vector<TypeSeq> TypeSeqs;
 typedef std::map<unsigned int, TypeSeqs> TypeSeqsMap;
@@ -57,24 +69,52 @@ const std::string currentDateTime() {
 }
 
 bool update_location_count(const TSubgraph& sg, 
-			   EdgeVectorMap& locationMap)
+			   LocationMap& locationMap)
 {
   if (!sg.is_valid()) return false;
 
-  // Note that if the motif hash or edge vector are not found in the
-  // corresponding maps, they are automatically created by
-  // map.operator[].
+  // Note that if the edge vector is not found in the map, it is
+  // automatically added by LocationMap::operator[].
   EdgeVector edges(sg.begin(), sg.end());
   locationMap[edges]++;
   return true;
 }
 
-unsigned int get_location_count(const EdgeVectorMap& locationMap,
+/* Update the location counts of valid subgraphs as they are
+   found. If a component hierarchy is given, each subgraph is counted
+   in locationMaps[i_tw] for every time window ch->time_window(i_tw)
+   with which it is valid; otherwise only locationMaps[0] is used. */
+class LocationCounter : public TSubgraphVisitor
+{
+ private:
+  std::vector<LocationMap>& locationMaps;
+  const Events& events;
+  const ComponentHierarchy* ch;
+ public:
+  LocationCounter(std::vector<LocationMap>& locationMaps, const Events& events,
+		  const ComponentHierarchy* ch)
+    : locationMaps(locationMaps), events(events), ch(ch) {};
+
+  void visit(const EventVector& eventVector, const EdgeVector& edges, unsigned int dt_max)
+  {
+    if (!ch) { locationMaps[0][edges]++; return; }
+
+    // The subgraph is connected with all time windows of at least
+    // dt_max. If it is valid with some time window, it is also valid
+    // with all smaller ones.
+    for (unsigned int i_tw = 0; i_tw < ch->size(); ++i_tw)
+      {
+	if (ch->time_window(i_tw) < dt_max) continue;
+	if (!TSubgraph::check_validity(events, eventVector, *ch, i_tw)) break;
+	locationMaps[i_tw][edges]++;
+      }
+  };
+};
+
+unsigned int get_location_count(const LocationMap& locationMap,
 				const EdgeVector& edges)
 {
-  EdgeVectorMap::const_iterator ev_it = locationMap.find(edges);
-  if (ev_it == locationMap.end()) return 0;
-  return ev_it->second;
+  return locationMap.get_count(edges);
 }
 
 bool get_edge_weights(const EdgeVector& edges,
@@ -85,8 +125,8 @@ bool get_edge_weights(const EdgeVector& edges,
   for (EdgeVector::const_iterator ev_it = edges.begin();
        ev_it != edges.end(); ++ev_it) 
     {
-      const NetType& net = *(nets.find(ev_it->type)->second);
-      unsigned int w = net[ev_it->from][ev_it->to];
+      const NetType& net = *(nets.find(ev_it->type())->second);
+      unsigned int w = net[ev_it->from()][ev_it->to()];
       if (w == 0) return false;
       weights.push_back(w);
     }
@@ -207,9 +247,46 @@ private:
 	      << "-m INT | --max_size INT\n"
 	      << "  The maximum number of events in valid subgraphs that are used to create motifs. If 0,\n"
 	      << "  detect all subgraphs. This can take a very long time if the time window is large.\n\n"
+	      << "--max_nodes INT\n"
+	      << "  The maximum number of nodes in motifs. Larger subgraphs are not searched. If 0 (default),\n"
+	      << "  there is no limit.\n\n"
+	      << "--max_edges INT\n"
+	      << "  The maximum number of edges in motifs, where events between the same two nodes with the\n"
+	      << "  same type are on the same edge. If 0 (default), there is no limit.\n\n"
 	      << "--maximal\n"
 	      << "  If given, detect only maximal subgraphs with at most '--max_size' events. If '--max_size'\n"
 	      << "  is 0, detects all maximal subgraphs.\n\n"
+	      << "--component_stats\n"
+	      << "  Write the distributions of the number of events, the number of nodes and the duration\n"
+	      << "  of maximal subgraphs into the file 'OUTPUTNAME_components.dat' and exit without finding\n"
+	      << "  motifs. Use this to check how large the maximal subgraphs are before running with\n"
+	      << "  '--maximal'.\n\n"
+	      << "--static\n"
+	      << "  Also count the static motifs, where the order of the events is disregarded. The counts\n"
+	      << "  of each temporal motif (and its references) are added to its static motif, and the\n"
+	      << "  results are written into the file 'OUTPUTNAME_static.dat' (with '--time_windows',\n"
+	      << "  'OUTPUTNAME_twTW_static.dat'). The motif_id column is -1 in these files.\n\n"
+	      << "--time_windows LIST\n"
+	      << "  Comma-separated list of additional time windows, for example '5,20,40'. The motifs are\n"
+	      << "  found only once with the largest time window and counted for each time window\n"
+	      << "  separately. The results for each time window TW are written into the file\n"
+	      << "  'OUTPUTNAME_twTW.dat'. At most 254 different time windows\n"
+	      << "  can be used. Cannot be used with '--maximal'.\n\n"
+	      << "--sample FLOAT\n"
+	      << "  Estimate the motif counts by finding the subgraphs of only this fraction of root\n"
+	      << "  events, sampled at random. The estimated counts are used in place of the exact ones,\n"
+	      << "  and the estimates with 95 % confidence intervals are also written into the file\n"
+	      << "  'OUTPUTNAME_sampled.dat'. With 1 all root events are used, and the estimates are the\n"
+	      << "  exact counts. The estimated count of each location is rounded to an integer, so\n"
+	      << "  locations estimated below 0.5 are left out of OUTPUTNAME.dat but not out of\n"
+	      << "  OUTPUTNAME_sampled.dat. Cannot be used with '--maximal' or '--time_windows'.\n\n"
+	      << "--sample_time INT\n"
+	      << "  Estimate the motif counts like with '--sample', but stop sampling root events after\n"
+	      << "  this many seconds. Can be combined with '--sample'.\n\n"
+	      << "--stratify\n"
+	      << "  When sampling, divide the root events into strata by the total number of events of\n"
+	      << "  their nodes (in bins of powers of two) and sample each stratum at the same rate.\n"
+	      << "  This usually gives smaller errors when the activity of nodes is very heterogeneous.\n\n"
 	      << "-r INT | --references INT\n"
 	      << "  The number of independent references to create. The references are created by generating\n"
 	      << "  random motif counts at each location.\n\n"
@@ -252,6 +329,19 @@ private:
 	      << "       0 : shuffle node types\n"
 	      << "       1 : shuffle event times (uniform)\n"
 	      << "      >1 : shuffle event times (with bias corresponding to value)\n\n"
+	      << "--catalogue FILE\n"
+	      << "  The file of untyped motifs and their ids (see '--catalogue_size'). If the file exists, the\n"
+	      << "  ids are read from it, and the catalogue is written back into it after counting, so the\n"
+	      << "  motifs keep their ids in all runs that use the same file.\n\n"
+	      << "--catalogue_size INT\n"
+	      << "  All untyped motifs with at most this many events (default 5) are numbered in advance in\n"
+	      << "  a fixed order. Larger motifs are numbered in the order they are found.\n\n"
+	      << "--threads INT\n"
+	      << "  The number of threads to use. By default this is given by the environment variable\n"
+	      << "  OMP_NUM_THREADS, or the number of cores if it is not set. The search for each root\n"
+	      << "  event is split into its independent branches, and the (root event, branch) pairs\n"
+	      << "  are handed out to idle threads four at a time (OpenMP schedule(dynamic,4); there is\n"
+	      << "  no work stealing within a branch). The time each thread spends searching is printed.\n\n"
 	      << "-s INT | --seed INT\n"
 	      << "  The seed for the random number generator. If omitted the system time is used.\n"
 	      << "\n"
@@ -270,7 +360,8 @@ private:
 	      << "               where the motif occurs in the input data\n"
 	      << "  9 N_loc_ref: mean number of locations in the aggregated network\n"
 	      << "               where the motif occur in the reference\n"
-	      << " 10 motif    : the motif itself\n"
+	      << " 10 motif_id : catalogue id of the untyped motif\n"
+	      << " 11 motif    : the motif itself\n"
 	      << "\n";
   };
 
@@ -282,10 +373,59 @@ private:
 	i++; if (i > argc) return false;
 	max_size = atoi(argv[i]);
       }
+    else if (name.compare("--max_nodes") == 0)
+      {
+	i++; if (i > argc) return false;
+	if (atoi(argv[i]) < 0) return false;
+	max_nodes = atoi(argv[i]);
+      }
+    else if (name.compare("--max_edges") == 0)
+      {
+	i++; if (i > argc) return false;
+	if (atoi(argv[i]) < 0) return false;
+	max_edges = atoi(argv[i]);
+      }
     else if (name.compare("--maximal") == 0)
       {
         maximal = true;
       }
+    else if (name.compare("--component_stats") == 0)
+      {
+        component_stats = true;
+      }
+    else if (name.compare("--static") == 0)
+      {
+        static_motifs = true;
+      }
+    else if (name.compare("--time_windows") == 0)
+      {
+	i++; if (i > argc) return false;
+	std::istringstream tw_stream(argv[i]);
+	std::string tw_str;
+	while (std::getline(tw_stream, tw_str, ','))
+	  {
+	    if (atoi(tw_str.c_str()) < 0) return false;
+	    time_windows.push_back(atoi(tw_str.c_str()));
+	  }
+      }
+    else if (name.compare("--sample") == 0)
+      {
+	i++; if (i > argc) return false;
+	sample_fraction = atof(argv[i]);
+	if (sample_fraction <= 0.0 || sample_fraction > 1.0) return false;
+	sampling = true;
+      }
+    else if (name.compare("--sample_time") == 0)
+      {
+	i++; if (i > argc) return false;
+	if (atoi(argv[i]) < 1) return false;
+	sample_time = atoi(argv[i]);
+	sampling = true;
+      }
+    else if (name.compare("--stratify") == 0)
+      {
+	stratify = true;
+      }
     else if ((name.compare("-r") == 0) || (name.compare("--references") == 0))
       {
 	i++; if (i > argc) return false;
@@ -329,6 +469,23 @@ private:
 	}
 	else return false;
       }
+    else if (name.compare("--catalogue") == 0)
+      {
+	i++; if (i > argc) return false;
+	catalogue_file_name = argv[i];
+      }
+    else if (name.compare("--catalogue_size") == 0)
+      {
+	i++; if (i > argc) return false;
+	if (atoi(argv[i]) < 0) return false;
+	catalogue_size = atoi(argv[i]);
+      }
+    else if (name.compare("--threads") == 0)
+      {
+	i++; if (i > argc) return false;
+	if (atoi(argv[i]) < 1) return false;
+	threads = atoi(argv[i]);
+      }
     else if ((name.compare("-s") == 0) || (name.compare("--seed") == 0))
       {
 	i++; if (i > argc) return false;
@@ -357,6 +514,36 @@ private:
     // given size.
     output_file_name = output_file_trunk + ".dat";
 
+    // With multiple time windows there is one output file for each.
+    if (!time_windows.empty())
+      {
+	if (maximal)
+	  {
+	    std::cout << "   Multiple time windows cannot be used with maximal motifs.\n";
+	    return false;
+	  }
+	time_windows.push_back(tw);
+	std::sort(time_windows.begin(), time_windows.end());
+	time_windows.erase(std::unique(time_windows.begin(), time_windows.end()), time_windows.end());
+	if (time_windows.size() > 254)
+	  {
+	    std::cout << "   At most 254 different time windows can be used.\n";
+	    return false;
+	  }
+      }
+    if (time_windows.size() == 1) time_windows.clear();
+
+    if (sampling && (maximal || !time_windows.empty()))
+      {
+	std::cout << "   Sampling cannot be used with maximal motifs or multiple time windows.\n";
+	return false;
+      }
+    if (!time_windows.empty())
+      {
+	output_file_name = output_file_trunk + "_twTW.dat";
+	if (verbose) std::cout << "   Time windows : " << time_windows << std::endl;
+      }
+
     if (verbose) 
       {
 	std::cout << "   Output file: " << output_file_name << std::endl;
@@ -369,6 +556,8 @@ private:
 	  {
 	    if (max_size) std::cout << "   Finding motifs with up to " << max_size << " events.\n";
 	    else std::cout << "   Finding all motifs with any number of events.\n";
+	    if (max_nodes) std::cout << "   Finding motifs with up to " << max_nodes << " nodes.\n";
+	    if (max_edges) std::cout << "   Finding motifs with up to " << max_edges << " edges.\n";
 	  }
 
 	if (!node_file_name.empty())
@@ -381,6 +570,16 @@ private:
 	    return false;
 	  }
 
+	if (sampling)
+	  {
+	    std::cout << "   Estimating counts from " << (stratify ? "a stratified" : "a uniform")
+		      << " sample of " << sample_fraction << " of root events";
+	    if (sample_time) std::cout << " (at most " << sample_time << " s)";
+	    std::cout << ".\n";
+	  }
+
+	if (static_motifs) std::cout << "   Counting also static motifs.\n";
+
 	if (references) std::cout << "   Creating "<<references<<" references (seed " << rng_seed << ")\n";
 	else std::cout << "   No references.\n";
 
@@ -401,10 +600,23 @@ private:
     if (verbose && edge_type_shuffling) std::cout << "   Shuffling edge types (seed " << rng_seed << ")\n";
     if (verbose && node_type_shuffling) std::cout << "   Shuffling node types (seed " << rng_seed << ")\n";
 
+#ifdef _OPENMP
+    if (threads) omp_set_num_threads(threads);
+    if (verbose) std::cout << "   Using " << omp_get_max_threads() << " threads.\n";
+#endif
+
     return true;
   };
 
 public:
+  /* Check that the subgraph is within the limits for the number of
+     nodes and edges. */
+  inline bool is_within_limits(const TSubgraph& sg) const
+  {
+    return ((!max_nodes || sg.nof_nodes() <= max_nodes) &&
+	    (!max_edges || sg.nof_edges() <= max_edges));
+  };
+
   // Required parameters.
   unsigned int tw;
   std::string output_file_trunk;
@@ -414,7 +626,16 @@ public:
 
   // Optional parameters.
   unsigned int max_size;
+  unsigned int max_nodes;
+  unsigned int max_edges;
+  std::vector<unsigned int> time_windows;
+  double sample_fraction;
+  unsigned int sample_time;
+  bool stratify;
+  bool sampling; // Set if sample_fraction or sample_time is given.
   bool maximal;
+  bool component_stats;
+  bool static_motifs;
   unsigned int references;
   std::string node_file_name;
   unsigned int time_gap;
@@ -426,12 +647,24 @@ public:
   bool edge_type_shuffling;
   bool node_type_shuffling;
   unsigned int rng_seed;
+  std::string catalogue_file_name;
+  unsigned int catalogue_size;
+  unsigned int threads;
 
   // Constructor sets default values for optional parameters.
   Parameters(bool verbose):
     verbose(verbose),
     max_size(0),
+    max_nodes(0),
+    max_edges(0),
+    time_windows(),
+    sample_fraction(1.0),
+    sample_time(0),
+    stratify(false),
+    sampling(false),
     maximal(false),
+    component_stats(false),
+    static_motifs(false),
     references(0),
     node_file_name(),
     time_gap(0),
@@ -442,7 +675,10 @@ public:
     bias_strength(1),
     edge_type_shuffling(false),
     node_type_shuffling(false),
-    rng_seed(time(NULL)) 
+    rng_seed(time(NULL)),
+    catalogue_file_name(),
+    catalogue_size(5),
+    threads(0)
   {};
 
   bool Init(int argc, char *argv[])
@@ -479,232 +715,387 @@ public:
 };
 
 
-/* Get all motifs and use them to fill locationMap.
+/* Find the range [i_first, i_last) of root events: skip the first
+   time_gap events and stop when the last time gap has been reached.
  */
-bool get_motifs(EdgeVectorMap& locationMap, 
-		const Events& events,
-		const Parameters& param,
-		std::vector<unsigned short int> const& node_types)
+void get_root_range(const Events& events, const Parameters& param,
+		    long& i_first, long& i_last)
 {
   unsigned int gap_0 = events.first_time() + param.time_gap;
   unsigned int gap_1 = events.last_start_time() - param.time_gap;
 
-  ProgressCounter evCounter(std::cerr, events.size(), 10);
-  for (Events::const_iterator e_it = events.begin(); e_it != events.end(); ++e_it)
+  i_first = 0; i_last = events.size();
+  while (i_first < i_last && events[i_first].start_time() < gap_0) ++i_first;
+  for (long i = i_first; i < i_last; ++i)
     {
-      // Run through the first time_gap events and break if
-      // the last time gap has been reached.
-      if (e_it->start_time() < gap_0) continue;
-      if (e_it->start_time() > gap_1) break;
+      if (events[i].start_time() > gap_1) { i_last = i; break; }
+    }
+}
 
-      // Print progress.
-      evCounter.next(*e_it);
+/* Get all motifs and use them to fill locationMaps[0]. If a
+   component hierarchy is given, the motifs are found with the largest
+   time window in it and locationMaps[i_tw] is filled for each time
+   window ch->time_window(i_tw); the component ids of events must
+   then be those of the smallest time window.
+ */
+bool get_motifs(std::vector<LocationMap>& locationMaps,
+		const Events& events,
+		const Parameters& param,
+		std::vector<unsigned short int> const& node_types,
+		const ComponentHierarchy* ch = NULL)
+{
+  long i_first, i_last;
+  get_root_range(events, param, i_first, i_last);
+
+  // Each thread counts the locations into its own maps (the first
+  // thread uses 'locationMaps' directly). Root events in bursts have
+  // far more subgraphs than isolated ones, so each root event is
+  // split into its independent search branches, and the (root,
+  // branch) pairs are handed out to idle threads four at a time by
+  // the dynamic schedule. The time each thread spends searching is
+  // reported to show how well the work is balanced.
+  unsigned int N_threads = 1;
+#ifdef _OPENMP
+  N_threads = omp_get_max_threads();
+#endif
+  std::vector<std::vector<LocationMap> > threadMaps(N_threads-1, std::vector<LocationMap>(locationMaps.size()));
+  unsigned int tw = (ch ? ch->time_window(ch->size()-1) : param.tw);
+  std::vector<double> busyTime(N_threads, 0);
+  ProgressCounter evCounter(std::cerr, i_last-i_first, 10);
+  const long N_branches = TSubgraphFinder::max_branches;
+
+#pragma omp parallel
+  {
+    unsigned int i_thread = 0;
+#ifdef _OPENMP
+    i_thread = omp_get_thread_num();
+#endif
+    LocationCounter locationCounter(i_thread == 0 ? locationMaps : threadMaps[i_thread-1], events, ch);
+    TSubgraphFinder sgf(0, tw, param.max_size, events, node_types);
+    sgf.set_limits(param.max_nodes, param.max_edges);
+
+#pragma omp for schedule(dynamic, 4) nowait
+    for (long i_work = 0; i_work < N_branches*(i_last-i_first); ++i_work)
+      {
+	event_id root = i_first + i_work/N_branches;
+	unsigned int i_branch = i_work % N_branches;
+
+	// Print progress.
+	if (i_branch == 0)
+	  {
+#pragma omp critical (progress)
+	    evCounter.next(events[root]);
+	  }
+
+	// Go through all valid subgraphs in this branch where the
+	// root event is the first one, and update the count of the
+	// corresponding motif at that location.
+#ifdef _OPENMP
+	double t_start = omp_get_wtime();
+#endif
+	sgf.find_subgraphs(root, i_branch, locationCounter);
+#ifdef _OPENMP
+	busyTime[i_thread] += omp_get_wtime() - t_start;
+#endif
+      }
+  }
 
-      // Iterate through all subgraphs where the current event is the
-      // first one, and update the count of the corresponding motif at
-      // that location.
-      TSubgraphFinder sgf(e_it->id(), param.tw, param.max_size, events, node_types);
-      for (TSubgraphFinder::iterator sit = sgf.begin(); sit != sgf.end(); ++sit)
+  if (N_threads > 1)
+    {
+      for (unsigned int i_thread = 0; i_thread < N_threads; ++i_thread)
+	{
+	  std::cout << "   Thread " << i_thread << " was busy for "
+		    << busyTime[i_thread] << " s.\n";
+	}
+    }
+
+  // Add up the counts of all threads.
+  for (unsigned int i_thread = 1; i_thread < N_threads; ++i_thread)
+    {
+      for (unsigned int i_map = 0; i_map < locationMaps.size(); ++i_map)
 	{
-	  const TSubgraph& sg = **sit;
-	  if (sg.is_valid()) update_location_count(sg, locationMap);
+	  locationMaps[i_map].add(threadMaps[i_thread-1][i_map]);
 	}
     }
   return true;
 }
 
-/* Get maximal motifs and use them to fill locationMap.
+/* Root event in the sample. The root events of all strata are
+   ordered by 'key' so that the strata are sampled at the same rate. */
+struct SampledRoot
+{
+  double key;
+  unsigned int stratum;
+  event_id root;
+  SampledRoot(double key, unsigned int stratum, event_id root)
+    : key(key), stratum(stratum), root(root) {};
+  bool operator<(const SampledRoot& other) const
+  {
+    if (key != other.key) return key < other.key;
+    return root < other.root;
+  };
+};
+
+/* Estimate the motif counts from a random sample of root events. The
+   estimated location counts (rounded to integers) are saved in
+   'locationMap', and the estimated motif counts with confidence
+   intervals are written into the file OUTPUTNAME_sampled.dat.
  */
-bool get_maximal_motifs(EdgeVectorMap& locationMap, 
+bool get_sampled_motifs(LocationMap& locationMap,
 			const Events& events,
 			const Parameters& param,
-			std::vector<unsigned short int> const& node_types)
+			std::vector<unsigned short int> const& node_types,
+			MotifCache& motif_cache,
+			MotifCatalogue& catalogue)
 {
-  unsigned int gap_0 = events.first_time() + param.time_gap;
-  unsigned int gap_1 = events.last_start_time() - param.time_gap;
-
-  // Maximal subgraphs are detected by inverting the maximal motif ids
-  // so that we get the set of events that correspond to each maximal
-  // subgraph id.
-  std::map<event_id, EventSet> maximal_subgraphs;
-  ProgressCounter evCounter(std::cerr, events.size(), 10);
-  for (Events::const_iterator e_it = events.begin(); e_it != events.end(); ++e_it)
+  long i_first, i_last;
+  get_root_range(events, param, i_first, i_last);
+
+  // Divide the root events into strata. When stratifying, stratum k
+  // contains the root events whose nodes have 2^k, ..., 2^(k+1)-1
+  // events in total.
+  std::vector<std::vector<event_id> > strata(1);
+  for (long i = i_first; i < i_last; ++i)
     {
-      // Run through the first time_gap events and break if
-      // the last time gap has been reached.
-      if (e_it->start_time() < gap_0) continue;
-      if (e_it->start_time() > gap_1) break;
-
-      // Print progress.
-      evCounter.next(*e_it);
-
-      // Add event to the maximal subgraph.
-      maximal_subgraphs[e_it->component()].insert(e_it->id());
+      unsigned int i_stratum = 0;
+      if (param.stratify)
+	{
+	  unsigned int activity = (events.nof_node_events(events[i].from()) +
+				   events.nof_node_events(events[i].to()));
+	  while (activity >>= 1) i_stratum++;
+	  if (i_stratum >= strata.size()) strata.resize(i_stratum+1);
+	}
+      strata[i_stratum].push_back(i);
     }
 
-  // Now we know the exact set of events in each maximal
-  // subgraph, so we just need to construct the corresponding
-  // motifs.
-  std::map<event_id, EventSet>::const_iterator ms_it;
-  for (ms_it = maximal_subgraphs.begin(); ms_it != maximal_subgraphs.end(); ms_it++)
+  // Take a simple random sample in each stratum. The root events
+  // are processed in the order of their relative position in the
+  // shuffled stratum, so that the strata are sampled at the same
+  // rate also when the time budget runs out.
+  std::vector<unsigned int> N_roots(strata.size());
+  std::vector<SampledRoot> sample;
+  for (unsigned int h = 0; h < strata.size(); ++h)
     {
-      // Skip maximal subgraphs that are too large.
-      if (param.max_size && ms_it->second.size() > param.max_size) continue;
-      // Create temporal sugraph and update the location count.
-      TSubgraph sg(events, ms_it->second, node_types, param.tw);
-      if (sg.is_valid()) update_location_count(sg, locationMap);
+      N_roots[h] = strata[h].size();
+      if (strata[h].empty()) continue;
+      std::random_shuffle(strata[h].begin(), strata[h].end());
+      unsigned int n_max = (unsigned int)(param.sample_fraction*N_roots[h] + 0.5);
+      if (n_max == 0) n_max = 1;
+      for (unsigned int k = 0; k < n_max; ++k)
+	{
+	  sample.push_back(SampledRoot((k + 0.5)/N_roots[h], h, strata[h][k]));
+	}
     }
-  return true;
-}
+  std::sort(sample.begin(), sample.end());
+
+  // Find the subgraphs of each sampled root event and add them to the
+  // estimates right away. Each thread keeps its own estimator and the
+  // total location counts of each stratum, because the weights of the
+  // strata are known only once the sampling has ended. The motif of
+  // each location is constructed only once per thread, and its
+  // catalogue id is found with the same projection as in
+  // count_motifs().
+  bool use_node_types = (param.hypothesis == 1);
+  bool use_event_types = (param.hypothesis == 0);
+  MotifEstimator estimator(N_roots);
+  std::vector<LocationMap> strataMaps(strata.size());
+  unsigned int n_sampled = 0;
+  time_t t_start = time(NULL);
+  ProgressCounter evCounter(std::cerr, sample.size(), 10);
 
-int main(int argc, char *argv[])
-{
-  // Read command line parameters.
-  Parameters param(true);
-  if (!param.Init(argc, argv)) exit(1);
-  std::cout << std::endl;
+#pragma omp parallel
+  {
+    std::vector<LocationMap> rootMap(1);
+    LocationCounter locationCounter(rootMap, events, NULL);
+    TSubgraphFinder sgf(0, param.tw, param.max_size, events, node_types);
+    sgf.set_limits(param.max_nodes, param.max_edges);
+
+    MotifEstimator threadEstimator(N_roots);
+    std::vector<LocationMap> threadStrata(strata.size());
+    unsigned int n_thread = 0;
+
+    // The count of a location in 'locationIds' is the index of its
+    // motif in 'motifIds' plus one.
+    LocationMap locationIds;
+    std::vector<MotifId> motifIds;
+    EdgeVector edges;
+
+#pragma omp for schedule(dynamic, 1)
+    for (long i = 0; i < (long)sample.size(); ++i)
+      {
+	// Skip the remaining root events once the time is up.
+	if (param.sample_time && difftime(time(NULL), t_start) >= param.sample_time) continue;
 
-  // Initialize RNG.
-  srand(param.rng_seed);
+	// Print progress.
+#pragma omp critical (progress)
+	evCounter.next(events[sample[i].root]);
 
-  // Read in the events.
-  std::cerr << "Reading events from stdin ...\n";
-  Events events(std::cin);
+	rootMap[0].clear();
+	sgf.find_subgraphs(sample[i].root, locationCounter);
 
-  // Try to read in the node types.
-  std::vector<unsigned short int> node_types(events.get_nof_nodes());
-  if (!param.node_file_name.empty())
-    {
-      unsigned int types_read = read_node_types(node_types, param.node_file_name);
-      if (types_read)
-        {
-	  unsigned int max_node_index = node_types.size()-1;
-	  std::vector<unsigned short int>::const_reverse_iterator rit = node_types.rbegin();
-	  while (rit != node_types.rend() && *rit == 0) 
-            {
-	      ++rit; max_node_index--;
-            }
-	  std::cout << "   Read the type of " << types_read << " nodes (max index " << max_node_index << ").\n";
-        }
-      else 
-        {
-	  std::cout << "   Failed to read node types from file '" << param.node_file_name << "'.\n";
-	  exit(1);
-        }
-    }
-  else std::cout << "Only one type (0) of nodes used.\n";
+	std::map<MotifId, unsigned int> counts;
+	for (size_t i_loc = 0; i_loc < rootMap[0].size(); ++i_loc)
+	  {
+	    rootMap[0].get_edges(i_loc, edges);
+	    unsigned int& i_motif = locationIds[edges];
+	    if (i_motif == 0)
+	      {
+		TSubgraph sg(edges, node_types);
+		MotifKey typed_key, labelled_key, signature;
+		sg.get_labelled_key(true, true, typed_key);
+		TSubgraph::project_key(typed_key, use_node_types, use_event_types, labelled_key);
+		const CachedMotif& motif_typed = motif_cache.get(sg, typed_key);
+		unsigned int motif_id;
+#pragma omp critical (catalogue)
+		motif_id = catalogue.get_id(labelled_key, signature);
+		threadEstimator.add_motif(motif_typed.id, motif_typed.motif, motif_id);
+		motifIds.push_back(motif_typed.id);
+		i_motif = motifIds.size();
+	      }
+	    counts[motifIds[i_motif-1]] += rootMap[0].count(i_loc);
+	  }
+	threadEstimator.add_root(sample[i].stratum, counts);
+	threadStrata[sample[i].stratum].add(rootMap[0]);
+	n_thread++;
+      }
 
-  // Shuffle event times and/or node types.
-  if (param.time_shuffling)
+#pragma omp critical (estimator)
     {
-      unsigned int shuffle_multiplier = 10;
-      std::cout << "Shuffling (" << shuffle_multiplier << " x N_events";
-      if (param.bias_strength > 1) std::cout << " with bias " << param.bias_strength;
-      std::cout << ")...\n" << std::flush;
-
-      if (param.bias_strength > 1) events.shuffle_constrained_corr(shuffle_multiplier, param.bias_strength);
-      else events.shuffle_constrained(shuffle_multiplier);
+      estimator.add(threadEstimator);
+      for (unsigned int h = 0; h < strata.size(); ++h) strataMaps[h].add(threadStrata[h]);
+      n_sampled += n_thread;
     }
-  if (param.node_type_shuffling)
+  }
+
+  // Estimate the location counts by weighting the total counts of
+  // each stratum. The count of a location in 'estimateIds' is the
+  // index of its estimate plus one. The estimates are rounded, so
+  // locations whose estimate is below 0.5 are left out.
+  LocationMap estimateIds;
+  std::vector<double> estimatedCounts;
+  EdgeVector edges;
+  for (unsigned int h = 0; h < strata.size(); ++h)
     {
-      std::random_shuffle(node_types.begin(), node_types.end());
+      double w = estimator.weight(h);
+      for (size_t i_loc = 0; i_loc < strataMaps[h].size(); ++i_loc)
+	{
+	  strataMaps[h].get_edges(i_loc, edges);
+	  unsigned int& i_est = estimateIds[edges];
+	  if (i_est == 0)
+	    {
+	      estimatedCounts.push_back(0);
+	      i_est = estimatedCounts.size();
+	    }
+	  estimatedCounts[i_est-1] += w*strataMaps[h].count(i_loc);
+	}
     }
-  if (param.edge_type_shuffling) 
+  for (size_t i_loc = 0; i_loc < estimateIds.size(); ++i_loc)
     {
-      if (!events.shuffle_edge_types())
-        {
-	  std::cerr << "Error: Unable to shuffle edge types because there were multiple event types on some edge.\n";
-	  exit(1);
-        }
+      unsigned int count = (unsigned int)(estimatedCounts[i_loc] + 0.5);
+      if (count == 0) continue;
+      estimateIds.get_edges(i_loc, edges);
+      locationMap[edges] = count;
     }
 
-  unsigned int gap_0 = events.first_time() + param.time_gap;
-  unsigned int gap_1 = events.last_start_time() - param.time_gap;
-
-  // EVENT TYPES: Create a set for saving event types in the data.
-  std::set<short int> eventTypes;
-
-  // Construct the weighted, directed aggregate network.
-  std::cerr << "Constructing aggregate network.\n";
-  std::cout << "Constructing aggregate network ("<< currentDateTime() <<").\n";
-  NetType net;
-  std::map<short int, NetType*> nets;
-  for (Events::iterator e_it = events.begin(); e_it != events.end(); ++e_it)
+  std::cout << "   Sampled " << n_sampled << " of " << i_last-i_first << " root events in "
+	    << strata.size() << " strata.\n";
+  unsigned int N_empty = 0;
+  for (unsigned int h = 0; h < strata.size(); ++h)
     {
-      // Run through the first time_gap events and break if
-      // the last time gap has been reached.
-      if (e_it->start_time() < gap_0) continue;
-      if (e_it->start_time() > gap_1) break;
-
-      // Print progress.
-      //evCounter.next(*e_it);
-      net[e_it->from()][e_it->to()] += 1;
-
-      // Update the set of event types.
-      eventTypes.insert(e_it->type());
-
-      // Increase count at the typed network.
-      std::map<short int, NetType*>::iterator m_it = nets.find(e_it->type());
-      if (m_it == nets.end()) 
-        {
-	  nets[e_it->type()] = new NetType;
-	  m_it = nets.find(e_it->type());
-        }
-      NetType& typed_net = *(m_it->second);
-      typed_net[e_it->from()][e_it->to()] += 1;
+      if (N_roots[h] && estimator.weight(h) == 0) N_empty++;
     }
+  if (N_empty) std::cout << "   Warning: " << N_empty << " strata have no sampled root events; "
+			 << "the estimates are too small.\n";
 
-  // Make all typed nets large enough to contain all nodes.
-  for (std::map<short int, NetType*>::iterator m_it = nets.begin();
-       m_it != nets.end(); ++m_it)
-    {
-      NetType& typed_net = *(m_it->second);
-      typed_net.resize(net.size());
-    }
+  return estimator.print(param.output_file_trunk + "_sampled.dat");
+}
 
-  // Find the maximal subgraph ids of each event.
-  // This is needed to properly detect motifs.
-  std::cerr << "Finding maximal subgraphs.\n";
-  std::cout << "Finding maximal subgraphs ("<< currentDateTime() <<").\n"; 
-  events.find_maximal_subgraphs(param.tw);
+/* Update the location counts of the maximal subgraphs that are
+   small enough. */
+class MaximalLocationCounter : public MaximalSubgraphVisitor
+{
+ private:
+  LocationMap& locationMap;
+  const Events& events;
+  const Parameters& param;
+  std::vector<unsigned short int> const& node_types;
+
+ public:
+  MaximalLocationCounter(LocationMap& locationMap, const Events& events,
+			 const Parameters& param, std::vector<unsigned short int> const& node_types)
+    : locationMap(locationMap), events(events), param(param), node_types(node_types) {};
+
+  void visit(event_id component, unsigned int size, const EventSet& eventSet)
+  {
+    // Skip maximal subgraphs that are too large.
+    if (param.max_size && size > param.max_size) return;
 
-  // Create maps for counting motifs by location.
-  EdgeVectorMap locationMap;
+    // Create temporal sugraph and update the location count.
+    TSubgraph sg(events, eventSet, node_types, param.tw);
+    if (sg.is_valid()) update_location_count(sg, locationMap);
+  };
+};
 
-  // ***************************
-  // *** FILL IN locationMap ***
-  // ***************************
-  // Find the number of motifs at each location where there is a motif.
-  if (param.maximal)
-    {
-      std::cerr << "Finding maximal typed motifs in data.\n";
-      get_maximal_motifs(locationMap, events, param, node_types);      
-    }
-  else
-    {
-      std::cerr << "Finding typed motifs in data.\n";
-      get_motifs(locationMap, events, param, node_types);
-    }
-  // Now 'get_location_count(locationMap, edges)' gives the number
-  // of motifs at location specified by 'edges'. Note that 'edges'
-  // includes information about the event types. Note that the edge
-  // sequence uniquely gives the node types at this location, so
-  // there is a unique typed hash to which this count corresponds
-  // to.
+/* Get maximal motifs and use them to fill locationMap. The maximal
+   subgraphs are streamed (see Events::stream_maximal_subgraphs()), so
+   that only those that may still grow are kept in memory.
+ */
+bool get_maximal_motifs(LocationMap& locationMap, 
+			const Events& events,
+			const Parameters& param,
+			std::vector<unsigned short int> const& node_types)
+{
+  unsigned int gap_0 = events.first_time() + param.time_gap;
+  unsigned int gap_1 = events.last_start_time() - param.time_gap;
 
-  //std::cout << locationMap << std::endl;
+  MaximalLocationCounter counter(locationMap, events, param, node_types);
+  ProgressCounter evCounter(std::cerr, events.size(), 10);
+  events.stream_maximal_subgraphs(param.tw, param.max_size, gap_0, gap_1, counter, &evCounter);
+  return true;
+}
 
+/* Compare the motif counts in 'locationMap' to the references
+   constructed from the aggregate network, and write the results into
+   'output_file_name'. If 'static_cache' is given, the counts are also
+   added to the static motifs, which are written into
+   'static_file_name'.
+ */
+bool count_motifs(const LocationMap& locationMap,
+		  const NetType& net,
+		  const std::map<short int, NetType*>& nets,
+		  const std::set<short int>& eventTypes,
+		  const Parameters& param,
+		  std::vector<unsigned short int> const& node_types,
+		  MotifCache& motif_cache,
+		  MotifCache* static_cache,
+		  MotifCatalogue& catalogue,
+		  const std::string& output_file_name,
+		  const std::string& static_file_name)
+{
   // Construct binner limits.
   std::set<unsigned int> bin_limits;
   get_limits_unbinned(net, bin_limits, param.weight_omit);
 
   // Object for counting motifs, both empirical and expected. The empirical counts 
   // should be placed at position 0, the references at position from 1 to param.references.
+  // The typed motifs are kept in a map by their identity: only the
+  // untyped motifs have dense ids, and the typed motifs that occur are
+  // a small and sparse part of all possible type combinations.
   ReferenceMotifCounter<double> motif_counts(param.references);
 
+  // The counts of static motifs are the sums of the counts of their
+  // temporal motifs. They are added at the same time as the counts
+  // of the temporal motifs, so the locations are gone through only
+  // once.
+  ReferenceMotifCounter<double> static_counts(param.references);
+
   // Create maps for counting the number of motifs by edge weights.
-  // weightsMap[untyped_hash] is a binner instance.
-  WeightsMap weightsMap;
+  // weightsMaps[motif_id][signature] is a binner instance, where
+  // motif_id is the catalogue id of the untyped motif and signature
+  // gives the node and event types that are not excluded. Only the
+  // outer level is a flat array; the signatures of each motif are in
+  // a std::map (WeightsMap), which has a single entry with '-h 2'.
+  std::vector<WeightsMap> weightsMaps(catalogue.size());
 
   // Get the event type sequences that we go through next.
   TypeSeqsMap event_type_seqs;
@@ -718,7 +1109,7 @@ int main(int argc, char *argv[])
 
 
   // ***************************
-  // *** FILL IN weightsMap ***
+  // *** FILL IN weightsMaps ***
   // ***************************
 
   std::cerr << "Finding all locations with at most "
@@ -737,15 +1128,20 @@ int main(int argc, char *argv[])
       for (TypeSeqs::const_iterator ets_it = event_type_seqs[nodePairs.size()].begin();
 	   ets_it != event_type_seqs[nodePairs.size()].end(); ++ets_it)
         {
-	  // Get the untyped motif of the temporal subgraph with
-	  // events on the given edges.
+	  // Get the catalogue id and type signature of the motif of the
+	  // temporal subgraph with events on the given edges. The
+	  // subgraph is labelled once: the key of the projected motif is
+	  // derived from the typed key, which also gives the typed motif.
 	  EdgeVector edges;
 	  create_edges(edges, nodePairs, *ets_it);
 
 	  TSubgraph sg(edges, node_types);
-	  Motif* motif_untyped = sg.get_motif(use_node_types, use_event_types, false);
-	  unsigned int untyped_hash = motif_untyped->get_hash();
-	  delete motif_untyped;
+	  if (!param.is_within_limits(sg)) continue;
+	  MotifKey typed_key, labelled_key, signature;
+	  sg.get_labelled_key(true, true, typed_key);
+	  TSubgraph::project_key(typed_key, use_node_types, use_event_types, labelled_key);
+	  unsigned int motif_id = catalogue.get_id(labelled_key, signature);
+	  if (motif_id >= weightsMaps.size()) weightsMaps.resize(catalogue.size());
 
 	  // Get the weight sequence of edges. Continue if some edge
 	  // has zero weight (this is possible because we are
@@ -755,7 +1151,7 @@ int main(int argc, char *argv[])
 	  if (!get_edge_weights(edges, nets, curr_weights)) continue;
 
 	  // Get the binner for this motif, and initialize it if one didn't exist.
-	  wBinner& curr_binner = weightsMap[untyped_hash];
+	  wBinner& curr_binner = weightsMaps[motif_id][signature];
 	  if (!curr_binner.is_initialized()) curr_binner.Init(bin_limits, edges.size());
 
 	  // Increase the binner at index given by weights by a value given
@@ -766,33 +1162,38 @@ int main(int argc, char *argv[])
 	      // The count at this location was successfully added, which means that 
 	      // the weights at this location are included in statistics. Increase the
 	      // count of the typed motif also.
-	      Motif* motif_typed = sg.get_typed_motif();
-	      motif_counts.add_at(motif_typed, 0, location_count);
+	      const CachedMotif& motif_typed = motif_cache.get(sg, typed_key);
+	      motif_counts.add_at(motif_typed.id, motif_typed.motif, 0, location_count, motif_id);
+	      if (static_cache)
+		{
+		  const CachedMotif& motif_static = static_cache->get(sg, typed_key);
+		  static_counts.add_at(motif_static.id, motif_static.motif, 0, location_count);
+		}
             }
 
 	  /* // DEBUG
 	     unsigned int sum, count;
-	     weightsMap[untyped_hash].get_sum(curr_weights, sum);
-	     weightsMap[untyped_hash].get_count(curr_weights, count);
+	     weightsMaps[motif_id][signature].get_sum(curr_weights, sum);
+	     weightsMaps[motif_id][signature].get_count(curr_weights, count);
 	     std::cerr << *sn_it << " " << curr_weights << " (" << sum << ", " << count << ")" << std::endl;
 	  */
 	}
     }
-  // weightsMap[motif_hash].get_random(edge_weights) now gives a
-  // random sample from the distribution of motif counts at
+  // weightsMaps[motif_id][signature].get_random(edge_weights) now
+  // gives a random sample from the distribution of motif counts at
   // locations with given weights sequence.
 
-  // Note that the 'motif_hash' used as key in weightsMap defines
-  // the reference system. If the hash corresponds to the untyped
+  // Note that the signature used as key in weightsMaps defines
+  // the reference system. If the signature corresponds to the untyped
   // motif (no event or node types), the null hypothesis is "Node
   // and event types do not affect motif counts." This is the only
   // option if the data has only node types or only event types.
 
   // If however the node has both node and event types, there are
   // more alternatives. We can then test against the null hypothesis
-  // "Event types do not affect motif counts" (when motif hash is
+  // "Event types do not affect motif counts" (when the signature is
   // obtained by omitting event types) or "Node types do not affect
-  // motif counts" (when motif hash is obtained by omitting node
+  // motif counts" (when the signature is obtained by omitting node
   // types).
 
   // ***************************
@@ -816,15 +1217,20 @@ int main(int argc, char *argv[])
       for (TypeSeqs::const_iterator ets_it = event_type_seqs[nodePairs.size()].begin();
 	   ets_it != event_type_seqs[nodePairs.size()].end(); ++ets_it)
 	{
-	  // Get the untyped motif of the temporal subgraph with
-	  // events on the given edges.
+	  // Get the catalogue id and type signature of the motif of the
+	  // temporal subgraph with events on the given edges. The
+	  // subgraph is labelled once: the key of the projected motif is
+	  // derived from the typed key, which also gives the typed motif.
 	  EdgeVector edges;
 	  create_edges(edges, nodePairs, *ets_it);
 
 	  TSubgraph sg(edges, node_types);
-	  Motif* motif_untyped = sg.get_motif(use_node_types, use_event_types, false);
-	  unsigned int untyped_hash = motif_untyped->get_hash();
-	  delete motif_untyped;
+	  if (!param.is_within_limits(sg)) continue;
+	  MotifKey typed_key, labelled_key, signature;
+	  sg.get_labelled_key(true, true, typed_key);
+	  TSubgraph::project_key(typed_key, use_node_types, use_event_types, labelled_key);
+	  unsigned int motif_id = catalogue.get_id(labelled_key, signature);
+	  if (motif_id >= weightsMaps.size()) weightsMaps.resize(catalogue.size());
 
 	  // Get the weight sequence of edges. Continue if some edge
 	  // has zero weight (this is possible because we are
@@ -836,19 +1242,21 @@ int main(int argc, char *argv[])
 	  // Get a random number of this motif given the edge weights at
 	  // this location for each reference.
 	  std::vector<unsigned int> ref_counts(param.references);
-	  if (weightsMap[untyped_hash].get_random(curr_weights, ref_counts))
+	  if (weightsMaps[motif_id][signature].get_random(curr_weights, ref_counts))
 	    { 
 	      // The weight sequence is included in the statistics.
 
 	      /* // DEBUG
 		 unsigned int sum, count;
-		 weightsMap[motif_ut_hash].get_sum(curr_weights, sum);
-		 weightsMap[motif_ut_hash].get_count(curr_weights, count);
+		 weightsMaps[motif_id][signature].get_sum(curr_weights, sum);
+		 weightsMaps[motif_id][signature].get_count(curr_weights, count);
 		 std::cout << *sn_it << " " << curr_weights << " (" << sum << ", " << count << ") = " << mean_count << std::endl;
 	      */
 
-	      // Get the typed motif spanned by these events.
-	      Motif* motif_typed = sg.get_typed_motif();
+	      // Get the typed motif spanned by these events, and its
+	      // static motif if needed.
+	      const CachedMotif& motif_typed = motif_cache.get(sg, typed_key);
+	      const CachedMotif* motif_static = (static_cache ? &static_cache->get(sg, typed_key) : NULL);
 
 	      // Add counts to the reference value of the typed motif (if
 	      // non-zero).
@@ -856,7 +1264,11 @@ int main(int argc, char *argv[])
 	      for (std::vector<unsigned int>::const_iterator ref_it = ref_counts.begin();
 		   ref_it != ref_counts.end(); ++ref_it)
 		{
-		  if (*ref_it) motif_counts.add_at(motif_typed, i_ref, *ref_it);
+		  if (*ref_it)
+		    {
+		      motif_counts.add_at(motif_typed.id, motif_typed.motif, i_ref, *ref_it, motif_id);
+		      if (motif_static) static_counts.add_at(motif_static->id, motif_static->motif, i_ref, *ref_it);
+		    }
 		  ++i_ref;
 		}
 	    }
@@ -865,8 +1277,285 @@ int main(int argc, char *argv[])
 
   // Print out the results.
   std::cout << "Calculations finished ("<< currentDateTime() <<")." << std::endl;
- if (motif_counts.print(param.output_file_name)) std::cout << "Results written ("<< currentDateTime() <<")." << std::endl;
-  else std::cout << "Error writing results to file! ("<< currentDateTime() <<")." << std::endl;
+  motif_cache.print_stats(std::cout);
+  if (static_cache)
+    {
+      static_cache->print_stats(std::cout);
+      if (!static_counts.print(static_file_name))
+	{
+	  std::cout << "Error writing results to file! ("<< currentDateTime() <<")." << std::endl;
+	  return false;
+	}
+    }
+  if (motif_counts.print(output_file_name))
+    {
+      std::cout << "Results written ("<< currentDateTime() <<")." << std::endl;
+      return true;
+    }
+  std::cout << "Error writing results to file! ("<< currentDateTime() <<")." << std::endl;
+  return false;
+}
+
+int main(int argc, char *argv[])
+{
+  // Read command line parameters.
+  Parameters param(true);
+  if (!param.Init(argc, argv)) exit(1);
+  std::cout << std::endl;
+
+  // Initialize RNG.
+  srand(param.rng_seed);
+
+  // Read in the events.
+  std::cerr << "Reading events from stdin ...\n";
+  Events events(std::cin);
+
+  // Edges are packed into 64 bits (see edges.h). Divide the bits
+  // between the node ids and the event types by the largest node id
+  // and the range of event types in the data.
+  if (events.size())
+    {
+      node_id max_node = 0;
+      short int min_type = events[0].type(), max_type = events[0].type();
+      for (Events::iterator e_it = events.begin(); e_it != events.end(); ++e_it)
+	{
+	  max_node = std::max(max_node, std::max(e_it->from(), e_it->to()));
+	  min_type = std::min(min_type, e_it->type());
+	  max_type = std::max(max_type, e_it->type());
+	}
+      if (!Edge::set_range(max_node, min_type, max_type))
+	{
+	  std::cerr << "Error: Node ids up to " << max_node << " and event types from " << min_type
+		    << " to " << max_type << " do not fit into 64 bits.\n";
+	  exit(1);
+	}
+    }
+
+  // Try to read in the node types.
+  std::vector<unsigned short int> node_types(events.get_nof_nodes());
+  if (!param.node_file_name.empty())
+    {
+      unsigned int types_read = read_node_types(node_types, param.node_file_name);
+      if (types_read)
+        {
+	  unsigned int max_node_index = node_types.size()-1;
+	  std::vector<unsigned short int>::const_reverse_iterator rit = node_types.rbegin();
+	  while (rit != node_types.rend() && *rit == 0) 
+            {
+	      ++rit; max_node_index--;
+            }
+	  std::cout << "   Read the type of " << types_read << " nodes (max index " << max_node_index << ").\n";
+        }
+      else 
+        {
+	  std::cout << "   Failed to read node types from file '" << param.node_file_name << "'.\n";
+	  exit(1);
+        }
+    }
+  else std::cout << "Only one type (0) of nodes used.\n";
+
+  // Shuffle event times and/or node types.
+  if (param.time_shuffling)
+    {
+      unsigned int shuffle_multiplier = 10;
+      std::cout << "Shuffling (" << shuffle_multiplier << " x N_events";
+      if (param.bias_strength > 1) std::cout << " with bias " << param.bias_strength;
+      std::cout << ")...\n" << std::flush;
+
+      if (param.bias_strength > 1) events.shuffle_constrained_corr(shuffle_multiplier, param.bias_strength);
+      else events.shuffle_constrained(shuffle_multiplier);
+    }
+  if (param.node_type_shuffling)
+    {
+      std::random_shuffle(node_types.begin(), node_types.end());
+    }
+  if (param.edge_type_shuffling) 
+    {
+      if (!events.shuffle_edge_types())
+        {
+	  std::cerr << "Error: Unable to shuffle edge types because there were multiple event types on some edge.\n";
+	  exit(1);
+        }
+    }
+
+  unsigned int gap_0 = events.first_time() + param.time_gap;
+  unsigned int gap_1 = events.last_start_time() - param.time_gap;
+
+  // EVENT TYPES: Create a set for saving event types in the data.
+  std::set<short int> eventTypes;
+
+  // Construct the weighted, directed aggregate network.
+  std::cerr << "Constructing aggregate network.\n";
+  std::cout << "Constructing aggregate network ("<< currentDateTime() <<").\n";
+  NetType net;
+  std::map<short int, NetType*> nets;
+  for (Events::iterator e_it = events.begin(); e_it != events.end(); ++e_it)
+    {
+      // Run through the first time_gap events and break if
+      // the last time gap has been reached.
+      if (e_it->start_time() < gap_0) continue;
+      if (e_it->start_time() > gap_1) break;
+
+      // Print progress.
+      //evCounter.next(*e_it);
+      net[e_it->from()][e_it->to()] += 1;
+
+      // Update the set of event types.
+      eventTypes.insert(e_it->type());
+
+      // Increase count at the typed network.
+      std::map<short int, NetType*>::iterator m_it = nets.find(e_it->type());
+      if (m_it == nets.end()) 
+        {
+	  nets[e_it->type()] = new NetType;
+	  m_it = nets.find(e_it->type());
+        }
+      NetType& typed_net = *(m_it->second);
+      typed_net[e_it->from()][e_it->to()] += 1;
+    }
+
+  // Make all typed nets large enough to contain all nodes.
+  for (std::map<short int, NetType*>::iterator m_it = nets.begin();
+       m_it != nets.end(); ++m_it)
+    {
+      NetType& typed_net = *(m_it->second);
+      typed_net.resize(net.size());
+    }
+
+  // Motifs are told apart by their labelled keys (see
+  // TSubgraph::get_labelled_key()), which only works if no node has
+  // the same color as an event. The colors are the types, or 0 for
+  // nodes and 1 for events when the hypothesis leaves them out.
+  std::set<unsigned int> node_colors(node_types.begin(), node_types.end());
+  bool same_colors = (param.hypothesis == 1 && node_colors.count(1));
+  for (std::set<short int>::const_iterator et_it = eventTypes.begin();
+       et_it != eventTypes.end(); ++et_it)
+    {
+      if (node_colors.count(*et_it) || (param.hypothesis == 0 && *et_it == 0)) same_colors = true;
+    }
+  if (same_colors)
+    {
+      std::cout << "   Warning: some node types are the same as event types. Different motifs\n"
+		<< "   may then be counted as the same motif.\n";
+    }
+
+  // Find the maximal subgraph ids of each event.
+  // This is needed to properly detect motifs.
+  std::cerr << "Finding maximal subgraphs.\n";
+  std::cout << "Finding maximal subgraphs ("<< currentDateTime() <<").\n"; 
+  if (param.component_stats)
+    {
+      ComponentStats stats;
+      events.find_maximal_subgraphs(param.tw, &stats);
+      std::cout << "   Found " << stats.nof_components() << " maximal subgraphs, the largest has "
+		<< stats.sizes.rbegin()->first << " events.\n";
+      if (param.max_size)
+	{
+	  unsigned int n_small = 0, n_events = 0;
+	  std::map<unsigned int, unsigned int>::const_iterator it;
+	  for (it = stats.sizes.begin(); it != stats.sizes.end() && it->first <= param.max_size; ++it)
+	    {
+	      n_small += it->second;
+	      n_events += it->first*it->second;
+	    }
+	  std::cout << "   " << n_small << " maximal subgraphs (" << n_events << " events) have at most "
+		    << param.max_size << " events.\n";
+	}
+      if (!stats.print(param.output_file_trunk + "_components.dat")) exit(1);
+      std::cout << "Maximal subgraph statistics written ("<< currentDateTime() <<")." << std::endl;
+      exit(0);
+    }
+
+  // Create maps for counting motifs by location, one for each time
+  // window. With multiple time windows the maximal subgraphs for all
+  // of them are found at once, and the component ids of events are
+  // set to those of the smallest time window.
+  std::vector<unsigned int> tws(1, param.tw);
+  ComponentHierarchy ch;
+  if (!param.time_windows.empty())
+    {
+      tws = param.time_windows;
+      events.find_maximal_subgraphs(tws, ch);
+      events.set_components(ch, 0);
+    }
+  else events.find_maximal_subgraphs(param.tw);
+  std::vector<LocationMap> locationMaps(tws.size());
+
+  // Typed motifs, and their static motifs with '--static', are
+  // constructed through caches shared by all time windows.
+  MotifCache motif_cache(motif_cache_size);
+  MotifCache static_cache(motif_cache_size, true, true);
+
+  // Number the untyped motifs, continuing from the catalogue file
+  // if it exists.
+  MotifCatalogue catalogue;
+  if (!param.catalogue_file_name.empty())
+    {
+      std::ifstream catalogue_file(param.catalogue_file_name.c_str());
+      if (catalogue_file.is_open())
+	{
+	  if (!catalogue.read(catalogue_file))
+	    {
+	      std::cout << "   Malformed catalogue file '" << param.catalogue_file_name << "'.\n";
+	      exit(1);
+	    }
+	  std::cout << "   Read " << catalogue.size() << " motifs from the catalogue.\n";
+	}
+    }
+  catalogue.generate(param.max_size ? std::min(param.max_size, param.catalogue_size) : param.catalogue_size);
+  std::cout << "   The catalogue has " << catalogue.size() << " untyped motifs.\n";
+
+  // ***************************
+  // *** FILL IN locationMap ***
+  // ***************************
+  // Find the number of motifs at each location where there is a motif.
+  if (param.maximal)
+    {
+      std::cerr << "Finding maximal typed motifs in data.\n";
+      get_maximal_motifs(locationMaps[0], events, param, node_types);
+    }
+  else if (param.sampling)
+    {
+      std::cerr << "Estimating typed motifs from a sample of root events.\n";
+      if (!get_sampled_motifs(locationMaps[0], events, param, node_types, motif_cache, catalogue)) exit(1);
+    }
+  else
+    {
+      std::cerr << "Finding typed motifs in data.\n";
+      get_motifs(locationMaps, events, param, node_types, (tws.size() > 1 ? &ch : NULL));
+    }
+  // Now 'get_location_count(locationMaps[i_tw], edges)' gives the number
+  // of motifs at location specified by 'edges'. Note that 'edges'
+  // includes information about the event types. Note that the edge
+  // sequence uniquely gives the node types at this location, so
+  // there is a unique typed hash to which this count corresponds
+  // to.
+
+  //std::cout << locationMaps << std::endl;
+
+  // The binners of the reference counts use rand(). With several time
+  // windows each one starts from the same seed, drawn after the
+  // shuffles, so that the windows are counted alike; a single time
+  // window simply continues the stream.
+  unsigned int count_seed = (tws.size() > 1 ? rand() : 0);
+
+  // Count motifs and their expected counts for each time window.
+  for (unsigned int i_tw = 0; i_tw < tws.size(); ++i_tw)
+    {
+      std::string output_file_trunk = param.output_file_trunk;
+      if (tws.size() > 1)
+	{
+	  std::ostringstream name_stream;
+	  name_stream << param.output_file_trunk << "_tw" << tws[i_tw];
+	  output_file_trunk = name_stream.str();
+	  std::cout << "Counting motifs with time window " << tws[i_tw] << ".\n";
+	  srand(count_seed);
+	}
+      count_motifs(locationMaps[i_tw], net, nets, eventTypes, param, node_types,
+		   motif_cache, (param.static_motifs ? &static_cache : NULL), catalogue,
+		   output_file_trunk + ".dat", output_file_trunk + "_static.dat");
+    }
+  if (!param.catalogue_file_name.empty() && !catalogue.write(param.catalogue_file_name)) exit(1);
 
   // Free nets.
   for (std::map<short int, NetType*>::iterator m_it = nets.begin();
@@ -2,6 +2,8 @@
  *  a method for printing it nicely. 
  */
 
+#include <algorithm>
+#include "uintseqhash.hh"
 #include "motif.h"
 
 std::ostream& operator<<(std::ostream& output, const Motif& m) 
@@ -19,3 +21,85 @@ std::ostream& operator<<(std::ostream& output, const Motif& m)
     }
   return output;
 }
+
+std::ostream& operator<<(std::ostream& output, const MotifId& id)
+{
+  output << id.hash;
+  return output;
+}
+
+void Motif::get_id(MotifId& id) const
+{
+  // Same as the identity of the canonical form under the identity
+  // labelling. Unlike get_hash(), this does not sort the edges of the
+  // graph, so shared motifs can be read by several threads at once.
+  std::vector<unsigned int> lab(get_nof_vertices()), inv;
+  for (unsigned int i = 0; i < lab.size(); ++i) lab[i] = i;
+  get_id(lab.empty() ? NULL : &lab[0], id, inv);
+}
+
+void Motif::get_id(const unsigned int* lab, MotifId& id, std::vector<unsigned int>& inv) const
+{
+  unsigned int N = get_nof_vertices();
+  inv.resize(N);
+  for (unsigned int v = 0; v < N; ++v) inv[lab[v]] = v;
+
+  // Hash the same sequence as get_hash() does for the canonical graph.
+  bliss::UintSeqHash h;
+  h.update(N);
+  id.code.resize(N+1);
+  id.code[0] = N;
+  for (unsigned int i = 0; i < N; ++i)
+    {
+      id.code[i+1] = vertices[inv[i]].color;
+      h.update(id.code[i+1]);
+    }
+  for (unsigned int i = 0; i < N; ++i)
+    {
+      const Vertex& v = vertices[inv[i]];
+      id.code.push_back(v.nof_edges_out());
+      unsigned int i_first = id.code.size();
+      for (unsigned int j = 0; j < v.nof_edges_out(); ++j) id.code.push_back(lab[v.edges_out[j]]);
+      std::sort(id.code.begin() + i_first, id.code.end());
+      for (unsigned int j = i_first; j < id.code.size(); ++j)
+	{
+	  h.update(i);
+	  h.update(id.code[j]);
+	}
+    }
+  id.hash = h.get_value();
+}
+
+void Motif::reset(unsigned int nof_vertices)
+{
+  for (unsigned int i = 0; i < vertices.size() && i < nof_vertices; ++i)
+    {
+      vertices[i].color = 0;
+      vertices[i].edges_in.clear();
+      vertices[i].edges_out.clear();
+    }
+  vertices.resize(nof_vertices);
+}
+
+MotifCanonizer::MotifCanonizer()
+  : g(),
+    lab(NULL),
+    inv(),
+    labels()
+{
+  g.set_splitting_heuristic(Motif::shs_f);
+  g.set_component_recursion(false);
+}
+
+Motif& MotifCanonizer::reset(unsigned int nof_vertices)
+{
+  lab = NULL;
+  g.reset(nof_vertices);
+  return g;
+}
+
+void MotifCanonizer::canonize()
+{
+  bliss::Stats stats;
+  lab = g.canonical_form(stats, NULL, NULL);
+}
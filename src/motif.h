@@ -5,13 +5,62 @@
  */
 
 #include <ostream>
+#include <vector>
 #include "graph.hh"
 
 #ifndef MOTIF_H
 #define MOTIF_H
 
+/* Identity of a canonical motif. The 32-bit bliss hash orders the
+ * motifs, and the canonical graph itself (number of vertices, vertex
+ * colors and the sorted out-edges of each vertex) tells apart motifs
+ * whose hashes collide. Comparing the hashes first keeps map
+ * operations almost as fast as with the bare hash.
+ */
+struct MotifId
+{
+  unsigned int hash;
+  std::vector<unsigned int> code;
+  MotifId() : hash(0), code() {};
+  inline bool operator<(const MotifId& other) const
+  {
+    if (hash != other.hash) return hash < other.hash;
+    return code < other.code;
+  };
+  inline bool operator==(const MotifId& other) const
+  {
+    return hash == other.hash && code == other.code;
+  };
+};
+
+std::ostream& operator<<(std::ostream& output, const MotifId& id);
+
 class Motif : public bliss::Digraph
 {
+ public:
+  /* Get the identity of the motif. The motif must be in canonical
+   * form (as returned by permute()) for the identity to be canonical.
+   * No data members may be added to this class because bliss creates
+   * the canonical graphs as bliss::Digraph objects. The graph is not
+   * modified (unlike by get_hash()).
+   */
+  void get_id(MotifId& id) const;
+
+  /* Get the identity of the canonical form of this motif given the
+   * canonical labelling 'lab' (as returned by canonical_form()). This
+   * gives the same result as permute() followed by get_id(), but
+   * without constructing the canonical graph. 'inv' is used as
+   * scratch space.
+   */
+  void get_id(const unsigned int* lab, MotifId& id, std::vector<unsigned int>& inv) const;
+
+  /* Remove all edges and set the number of vertices. The edge lists
+   * of the remaining vertices keep their memory, so a graph that is
+   * reset and refilled for each motif does not need to allocate
+   * memory once it has seen a large enough motif.
+   */
+  void reset(unsigned int nof_vertices);
+
   /**
    * Print the graph on one line. Format is
    *    N [0:c_0,1:c_1,...] i,j k,l ...
@@ -22,4 +71,53 @@ class Motif : public bliss::Digraph
   friend std::ostream& operator<<(std::ostream& output, const Motif& g);
 };
 
+/* Reusable context for finding canonical forms. The graph is reset
+ * and refilled for each motif, and the identity of the canonical form
+ * is found from the canonical labelling without constructing the
+ * canonical graph.
+ *
+ * Thread safety: this is the entry point for finding canonical forms
+ * in parallel, with one context for each thread. The bliss library
+ * has no writable global or static state (the only static table, the
+ * one used by UintSeqHash, is constant), and the whole state of the
+ * search (partition, labellings, certificates, heaps) is kept in the
+ * graph object. Different graphs can therefore be canonized at the
+ * same time, but a context must not be used by several threads at
+ * the same time. Of the methods of bliss::Digraph, canonical_form(),
+ * get_hash(), cmp(), write_dot() and write_dimacs() modify the graph (they
+ * remove duplicate edges and sort the edge lists), so a graph that is
+ * shared by threads, such as a motif in MotifCache, may only be used
+ * through const methods: get_id(), permute() and printing.
+ */
+class MotifCanonizer
+{
+ private:
+  Motif g;
+  const unsigned int* lab;       // Canonical labelling of g.
+  std::vector<unsigned int> inv; // Scratch space for get_id().
+
+  // Not copyable, 'lab' points into 'g'.
+  MotifCanonizer(const MotifCanonizer&);
+  MotifCanonizer& operator=(const MotifCanonizer&);
+
+ public:
+  // Scratch space for the caller that fills in the graph.
+  std::vector<unsigned int> labels;
+
+  MotifCanonizer();
+
+  /* Reset the graph to 'nof_vertices' vertices without edges and
+   * return it for filling in. */
+  Motif& reset(unsigned int nof_vertices);
+
+  /* Find the canonical labelling of the graph. */
+  void canonize();
+
+  /* Get the identity of the canonical form. */
+  inline void get_id(MotifId& id) { g.get_id(lab, id, inv); };
+
+  /* Construct the canonical form. The caller must delete it. */
+  inline Motif* get_motif() const { return static_cast<Motif*>(g.permute(lab)); };
+};
+
 #endif
@@ -0,0 +1,238 @@
+#include <iomanip>
+#include "motif_cache.h"
+
+MotifCache::Entry* MotifCache::EntryTable::find(const MotifKey& key, unsigned int h) const
+{
+  if (slots.empty()) return NULL;
+  size_t mask = slots.size() - 1;
+  for (size_t i_slot = h & mask; slots[i_slot]; i_slot = (i_slot + 1) & mask)
+    {
+      Entry* entry = slots[i_slot];
+      if (entry->hash == h && entry->key == key) return entry;
+    }
+  return NULL;
+}
+
+void MotifCache::EntryTable::insert(Entry* entry)
+{
+  // Keep the table at most half full.
+  if (2*(n_entries + 1) > slots.size())
+    {
+      std::vector<Entry*> new_slots(slots.empty() ? 16 : 2*slots.size(), (Entry*)NULL);
+      size_t mask = new_slots.size() - 1;
+      for (size_t i = 0; i < slots.size(); ++i)
+	{
+	  if (!slots[i]) continue;
+	  size_t i_slot = slots[i]->hash & mask;
+	  while (new_slots[i_slot]) i_slot = (i_slot + 1) & mask;
+	  new_slots[i_slot] = slots[i];
+	}
+      slots.swap(new_slots);
+    }
+
+  size_t mask = slots.size() - 1;
+  size_t i_slot = entry->hash & mask;
+  while (slots[i_slot]) i_slot = (i_slot + 1) & mask;
+  slots[i_slot] = entry;
+  n_entries++;
+}
+
+unsigned int MotifCache::hash(const MotifKey& key)
+{
+  // Same mixing as in LocationMap::hash(), so that both the lowest
+  // and the highest bits depend on the whole key.
+  unsigned long long int h = key.size();
+  for (size_t i = 0; i < key.size(); ++i)
+    {
+      h = (h ^ key[i])*0x9E3779B97F4A7C15ULL;
+      h ^= h >> 29;
+    }
+  return (unsigned int)(h ^ (h >> 32));
+}
+
+MotifCache::MotifCache(size_t max_entries, bool typed, bool is_static)
+  : shards(),
+    threads(),
+    typed(typed),
+    is_static(is_static)
+{
+  for (unsigned int i = 0; i < (1U << shard_bits); ++i)
+    {
+      shards.push_back(new Shard());
+      // The remainder of 'max_entries' goes to the first shards.
+      shards.back()->max_entries = ((max_entries >> shard_bits) +
+				    (i < (max_entries & ((1U << shard_bits) - 1))));
+#ifdef _OPENMP
+      omp_init_lock(&shards.back()->lock);
+#endif
+    }
+
+  unsigned int nof_threads = 1;
+#ifdef _OPENMP
+  nof_threads = omp_get_max_threads();
+#endif
+  for (unsigned int i = 0; i < nof_threads; ++i) threads.push_back(new ThreadState());
+}
+
+MotifCache::~MotifCache()
+{
+  for (unsigned int i = 0; i < shards.size(); ++i)
+    {
+      const std::vector<Entry*>& slots = shards[i]->entries.get_slots();
+      for (size_t i_slot = 0; i_slot < slots.size(); ++i_slot)
+	{
+	  if (!slots[i_slot]) continue;
+	  delete slots[i_slot]->cm.motif;
+	  delete slots[i_slot];
+	}
+#ifdef _OPENMP
+      omp_destroy_lock(&shards[i]->lock);
+#endif
+      delete shards[i];
+    }
+  for (unsigned int i = 0; i < threads.size(); ++i)
+    {
+      delete threads[i]->overflow.motif;
+      delete threads[i];
+    }
+}
+
+const CachedMotif& MotifCache::get(const TSubgraph& sg)
+{
+  MotifKey key;
+  sg.get_labelled_key(typed, typed, key);
+  return get(sg, key);
+}
+
+const CachedMotif& MotifCache::get(const TSubgraph& sg, const MotifKey& key)
+{
+  unsigned int i_thread = 0;
+#ifdef _OPENMP
+  i_thread = omp_get_thread_num();
+#endif
+  assert(i_thread < threads.size());
+  ThreadState& ts = *threads[i_thread];
+
+  // Motifs this thread has already seen need no lock.
+  unsigned int h = hash(key);
+  Entry* entry = ts.seen.find(key, h);
+  if (entry != NULL)
+    {
+      ts.n_hits++;
+      return entry->cm;
+    }
+
+  // Look up the motif in its shard. Bliss is run without holding the
+  // lock, so another thread may have added the same motif in the
+  // meantime.
+  Shard& shard = *shards[h >> (32 - shard_bits)];
+  bool is_full = false;
+#ifdef _OPENMP
+  omp_set_lock(&shard.lock);
+#endif
+  entry = shard.entries.find(key, h);
+  if (entry == NULL) is_full = (shard.entries.size() >= shard.max_entries);
+#ifdef _OPENMP
+  omp_unset_lock(&shard.lock);
+#endif
+  if (entry != NULL)
+    {
+      ts.n_hits++;
+      ts.seen.insert(entry);
+      return entry->cm;
+    }
+
+  ts.n_misses++;
+  MotifCanonizer& c = ts.canonizer;
+  sg.canonize(c, typed, typed, is_static);
+
+  if (!is_full)
+    {
+      Entry* new_entry = new Entry();
+      new_entry->key = key;
+      new_entry->hash = h;
+      c.get_id(new_entry->cm.id);
+      new_entry->cm.motif = c.get_motif();
+#ifdef _OPENMP
+      omp_set_lock(&shard.lock);
+#endif
+      entry = shard.entries.find(key, h);
+      if (entry == NULL && shard.entries.size() < shard.max_entries)
+	{
+	  shard.entries.insert(new_entry);
+	  entry = new_entry;
+	  new_entry = NULL;
+	}
+#ifdef _OPENMP
+      omp_unset_lock(&shard.lock);
+#endif
+      if (entry != NULL)
+	{
+	  if (new_entry != NULL)
+	    {
+	      delete new_entry->cm.motif;
+	      delete new_entry;
+	    }
+	  ts.seen.insert(entry);
+	  return entry->cm;
+	}
+
+      // The shard was filled by other threads in the meantime.
+      CachedMotif& ov = ts.overflow;
+      delete ov.motif;
+      ov = new_entry->cm;
+      delete new_entry;
+      return ov;
+    }
+
+  // The shard is full; keep the motif until the next call.
+  CachedMotif& ov = ts.overflow;
+  delete ov.motif;
+  c.get_id(ov.id);
+  ov.motif = c.get_motif();
+  return ov;
+}
+
+size_t MotifCache::size() const
+{
+  size_t n = 0;
+  for (unsigned int i = 0; i < shards.size(); ++i) n += shards[i]->entries.size();
+  return n;
+}
+
+unsigned long long int MotifCache::hits() const
+{
+  unsigned long long int n = 0;
+  for (unsigned int i = 0; i < threads.size(); ++i) n += threads[i]->n_hits;
+  return n;
+}
+
+unsigned long long int MotifCache::misses() const
+{
+  unsigned long long int n = 0;
+  for (unsigned int i = 0; i < threads.size(); ++i) n += threads[i]->n_misses;
+  return n;
+}
+
+void MotifCache::print_stats(std::ostream& os) const
+{
+  unsigned long long int n_hits = hits();
+  unsigned long long int n_lookups = n_hits + misses();
+  os << (is_static ? "   Static motif cache: " : "   Motif cache: ") << size() << " motifs, "
+     << n_hits << " hits in " << n_lookups << " lookups";
+  if (n_lookups)
+    {
+      std::ios::fmtflags flags = os.flags();
+      std::streamsize precision = os.precision();
+      os << " (" << std::fixed << std::setprecision(1) << 100.0*n_hits/n_lookups << " %)";
+      os.flags(flags);
+      os.precision(precision);
+    }
+  bool is_full = false;
+  for (unsigned int i = 0; i < shards.size(); ++i)
+    {
+      if (shards[i]->entries.size() >= shards[i]->max_entries) is_full = true;
+    }
+  if (is_full) os << ", cache full";
+  os << ".\n";
+}
@@ -0,0 +1,147 @@
+/*
+Cache of canonical motifs.
+
+The same small motifs are constructed again and again when going
+through the locations of the aggregate network, and finding the
+canonical form with bliss is the most expensive part of handling a
+location. The cache maps the event sequence of a subgraph, with the
+nodes relabelled in the order of first appearance and with the node
+and event colors (or none of them for untyped motifs), to the
+canonical motif. This key determines the motif, so each repeated
+motif costs a single lookup instead of a call to bliss.
+
+A cache for static motifs maps the same keys of temporal motifs to
+their static motifs (the order of the events left out). Each static
+motif is then canonized once for each temporal motif, and the counts
+of temporal motifs can be added to their static motifs as they are
+counted.
+
+The cache is a hash table of the keys split into shards by the hash,
+each with its own lock, so that threads looking up different motifs
+rarely wait for each other. The entries are never moved or removed,
+and each thread also keeps its own table of the entries it has
+already seen. Most lookups are repeats of the same motifs, and these
+are answered from the thread's own table without taking any lock.
+
+The cache owns the motifs it stores, together with their identities.
+'max_entries' limits the number of motifs (not their size in bytes),
+and each shard holds at most its share of them. Once a shard is
+full, new motifs of that shard are no longer stored and a motif that
+is not in the cache is kept only until the next lookup by the same
+thread. Each thread canonizes with its own MotifCanonizer. There is
+one for each of the omp_get_max_threads() threads at the time the
+cache is constructed, so the cache must not be used by more threads
+than that. The returned motifs may be used by several threads, but
+only through their const methods (see MotifCanonizer).
+*/
+
+#ifndef MOTIF_CACHE_H
+#define MOTIF_CACHE_H
+
+#include <vector>
+#include <iostream>
+#include "motif.h"
+#include "tsubgraph.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/* Canonical motif and its identity. */
+struct CachedMotif
+{
+  MotifId id;
+  Motif* motif;
+  CachedMotif() : id(), motif(NULL) {};
+};
+
+class MotifCache
+{
+ private:
+  /* Cached motif with its key. */
+  struct Entry
+  {
+    MotifKey key;
+    unsigned int hash;
+    CachedMotif cm;
+    Entry() : key(), hash(0), cm() {};
+  };
+
+  /* Open addressing hash table of entries with linear probing, like
+     in LocationMap. The table only holds pointers, so the entries do
+     not move when it grows. */
+  class EntryTable
+  {
+  private:
+    std::vector<Entry*> slots;
+    size_t n_entries;
+  public:
+    EntryTable() : slots(), n_entries(0) {};
+    Entry* find(const MotifKey& key, unsigned int h) const;
+    void insert(Entry* entry); // The key must not be in the table.
+    inline size_t size() const { return n_entries; };
+    inline const std::vector<Entry*>& get_slots() const { return slots; };
+  };
+
+  struct Shard
+  {
+    EntryTable entries;
+    size_t max_entries; // Share of the maximum number of motifs.
+#ifdef _OPENMP
+    omp_lock_t lock;
+#endif
+  };
+
+  /* Lookup state of a thread. */
+  struct ThreadState
+  {
+    EntryTable seen;          // Entries this thread has found.
+    MotifCanonizer canonizer;
+    CachedMotif overflow;     // Last uncached motif.
+    unsigned long long int n_hits;
+    unsigned long long int n_misses;
+    ThreadState() : seen(), canonizer(), overflow(), n_hits(0), n_misses(0) {};
+  };
+
+  // The shard of a key is given by the highest bits of its hash,
+  // and the slots of the tables by the lowest ones.
+  static const unsigned int shard_bits = 6;
+  std::vector<Shard*> shards;
+  std::vector<ThreadState*> threads; // One for each thread.
+  bool typed;
+  bool is_static;
+
+  static unsigned int hash(const MotifKey& key);
+
+  // Not copyable, the motifs are owned by this object.
+  MotifCache(const MotifCache&);
+  MotifCache& operator=(const MotifCache&);
+
+ public:
+  /* Cache for typed motifs, or for untyped ones if 'typed' is
+     false. If 'is_static' is true, the cache gives the static motifs
+     of the subgraphs. */
+  MotifCache(size_t max_entries, bool typed = true, bool is_static = false);
+
+  /* Delete the cached motifs. */
+  ~MotifCache();
+
+  /* Get the motif of 'sg' and its identity. */
+  const CachedMotif& get(const TSubgraph& sg);
+
+  /* Same as above when the labelled key of 'sg' (typed or untyped as
+     the cache) is already known. */
+  const CachedMotif& get(const TSubgraph& sg, const MotifKey& key);
+
+  /* Number of cached motifs, and the numbers of lookups that found
+     the motif in the cache and that did not. Only valid when no
+     thread is looking up motifs. */
+  size_t size() const;
+  unsigned long long int hits() const;
+  unsigned long long int misses() const;
+
+  /* Print the number of motifs and the hit rate. */
+  void print_stats(std::ostream& os) const;
+};
+
+#endif
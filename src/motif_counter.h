@@ -21,12 +21,13 @@ template <typename T> struct MotifCount
   unsigned int count;
   std::string* desc;
   std::vector<T> ref_counts;
+  int motif_id; // Catalogue id of the untyped motif, -1 if not known.
   MotifCount();
   ~MotifCount();
 };
 
 template <typename T> MotifCount<T>::MotifCount() 
-: count(0),desc(NULL),ref_counts() {}
+: count(0),desc(NULL),ref_counts(),motif_id(-1) {}
 
 template <typename T> MotifCount<T>::~MotifCount() 
 {
@@ -44,24 +45,30 @@ std::ostream& operator<<(std::ostream& output, const MotifCount<T>& mc)
 template <typename T> class MotifCounter
 {
  private:
-  // Map for saving motif counts. The key is the motif hash, the value
-  // is a pair that consists of motif counts and a string description of
-  // the motifs.
-  typedef std::map<unsigned int, MotifCount<T> > MotifCountMap;
+  // Map for saving motif counts. The key is the motif identity, the
+  // value is a pair that consists of motif counts and a string
+  // description of the motifs.
+  typedef std::map<MotifId, MotifCount<T> > MotifCountMap;
 
   MotifCountMap mcm;
 
  protected:
   unsigned int N; // Number of other values in addition to empirical one.
 
-  // Sort motifs by count in data.
-  void sort_by_count(std::multimap<unsigned int, unsigned int>& sorted_counts) const;
-  void sort_by_ref_count(std::multimap<T, unsigned int>& sorted_counts) const;
+  // Sort motifs by count in data. The values point to the keys of
+  // this counter.
+  void sort_by_count(std::multimap<unsigned int, const MotifId*>& sorted_counts) const;
+  void sort_by_ref_count(std::multimap<T, const MotifId*>& sorted_counts) const;
 
   // Access results.
-  inline unsigned int count(unsigned int hash) const { return mcm.find(hash)->second.count; };
-  inline std::vector<T> const& counts(unsigned int hash) const { return mcm.find(hash)->second.ref_counts; };
-  inline std::string const& desc(unsigned int hash) const { return *(mcm.find(hash)->second.desc); };
+  inline unsigned int count(const MotifId& id) const { return mcm.find(id)->second.count; };
+  inline std::vector<T> const& counts(const MotifId& id) const { return mcm.find(id)->second.ref_counts; };
+  inline std::string const& desc(const MotifId& id) const { return *(mcm.find(id)->second.desc); };
+  inline int motif_id(const MotifId& id) const { return mcm.find(id)->second.motif_id; };
+
+  // Increase count of motif m, whose identity is 'id', at position i
+  // by val.
+  virtual void add_id_at(const MotifId& id, Motif *m, unsigned int i, T val, int motif_id);
 
  public:
   // Really simple constructor.
@@ -70,8 +77,18 @@ template <typename T> class MotifCounter
   // Increase count of motif m at position i by 1.
   virtual void increment_at(Motif *m, unsigned int i) { add_at(m,i,1); };
 
-  // Increase count of motif m at position i by val.
-  virtual void add_at(Motif *m, unsigned int i, T val);
+  // Increase count of motif m at position i by val. 'motif_id' is
+  // the catalogue id of the untyped motif (see MotifCatalogue).
+  void add_at(Motif *m, unsigned int i, T val, int motif_id = -1)
+  {
+    MotifId id; m->get_id(id); add_id_at(id,m,i,val,motif_id);
+  };
+
+  // Same as above when the identity of m is already known.
+  void add_at(const MotifId& id, Motif *m, unsigned int i, T val, int motif_id = -1)
+  {
+    add_id_at(id,m,i,val,motif_id);
+  };
 
   // Print output.
   virtual bool print(const std::string& fileName) const =0;
@@ -84,12 +101,14 @@ template <typename T> class ReferenceMotifCounter : public MotifCounter<T>
  protected:
   // Save the number of locations where the motif occurs (index 1 for 
   // empirical data and 2-> for references) and the total number of
-  // locations in the aggregate network (index 0). Key is the motif hash.
-  std::map<unsigned int, std::vector<unsigned int> > locationCounts;
+  // locations in the aggregate network (index 0). Key is the motif
+  // identity.
+  std::map<MotifId, std::vector<unsigned int> > locationCounts;
+
+  void add_id_at(const MotifId& id, Motif *m, unsigned int i, T val, int motif_id);
 
  public:
   ReferenceMotifCounter(unsigned int N_ref);
-  void add_at(Motif *m, unsigned int i, T val);
   bool print(const std::string& fileName) const;
 };
 
@@ -113,30 +132,31 @@ template<typename T>
 MotifCounter<T>::MotifCounter(unsigned int N) : mcm(), N(N) {}
 
 template<typename T>
-void MotifCounter<T>::add_at(Motif *m, unsigned int i, T value)
+void MotifCounter<T>::add_id_at(const MotifId& id, Motif *m, unsigned int i, T value, int motif_id)
 {
-  MotifCount<T>& mc = mcm[m->get_hash()];
+  MotifCount<T>& mc = mcm[id];
   if (mc.desc == NULL) 
     {
       mc.desc = new std::string(to_string(*m));
       mc.ref_counts.resize(N);
+      mc.motif_id = motif_id;
     }
   if (i == 0) mc.count += value;
   else mc.ref_counts[i-1] += value;
 }
 
 template<typename T>
-void MotifCounter<T>::sort_by_count(std::multimap<unsigned int, unsigned int>& sorted_counts) const
+void MotifCounter<T>::sort_by_count(std::multimap<unsigned int, const MotifId*>& sorted_counts) const
 {
   typename MotifCountMap::const_iterator m_it;
   for (m_it = mcm.begin(); m_it != mcm.end(); ++m_it)
     {
-      sorted_counts.insert(std::make_pair(m_it->second.count,m_it->first));
+      sorted_counts.insert(std::make_pair(m_it->second.count,&m_it->first));
     }
 }
 
 template<typename T>
-void MotifCounter<T>::sort_by_ref_count(std::multimap<T, unsigned int>& sorted_counts) const
+void MotifCounter<T>::sort_by_ref_count(std::multimap<T, const MotifId*>& sorted_counts) const
 {
   typename MotifCountMap::const_iterator m_it;
   for (m_it = mcm.begin(); m_it != mcm.end(); ++m_it)
@@ -144,7 +164,7 @@ void MotifCounter<T>::sort_by_ref_count(std::multimap<T, unsigned int>& sorted_c
       T total_count = 0;
       for (typename std::vector<T>::const_iterator v_it = m_it->second.ref_counts.begin();
 	   v_it != m_it->second.ref_counts.end(); v_it++) total_count += *v_it;
-      sorted_counts.insert(std::make_pair(total_count, m_it->first));
+      sorted_counts.insert(std::make_pair(total_count, &m_it->first));
     }
 }
 
@@ -154,12 +174,12 @@ ReferenceMotifCounter<T>::ReferenceMotifCounter(unsigned int N_ref)
 {}
 
 template<typename T>
-void ReferenceMotifCounter<T>::add_at(Motif *m, unsigned int i, T value)
+void ReferenceMotifCounter<T>::add_id_at(const MotifId& id, Motif *m, unsigned int i, T value, int motif_id)
 {
-  MotifCounter<T>::add_at(m,i,value);
+  MotifCounter<T>::add_id_at(id,m,i,value,motif_id);
 
   // Increment the location count.
-  std::vector<unsigned int>& v = locationCounts[m->get_hash()];
+  std::vector<unsigned int>& v = locationCounts[id];
   if (v.empty()) v.resize((this->N)+2);
   if (i == 0) v[0]++;
   if (value > 0) v[i+1]++;
@@ -171,7 +191,7 @@ bool ReferenceMotifCounter<T>::print(const std::string& fileName) const
   /* Sort the map keys by count in the actual data so they can be
      easily printed in sorted order. (The multimap is automatically
      sorted by its key.) */
-  std::multimap<unsigned int, unsigned int> sorted_counts;
+  std::multimap<unsigned int, const MotifId*> sorted_counts;
   this->sort_by_count(sorted_counts);
   
   std::cout << "Writing results to file " << std::endl;
@@ -199,12 +219,13 @@ bool ReferenceMotifCounter<T>::print(const std::string& fileName) const
 	 << "N_loc_tot   "
 	 << "N_loc       "
 	 << "N_loc_ref     "
+	 << "motif_id  "
 	 << "N [node:color ...] edges ..." << std::endl;
 	
-  std::multimap<unsigned int, unsigned int>::reverse_iterator s_it;
+  std::multimap<unsigned int, const MotifId*>::reverse_iterator s_it;
   for (s_it = sorted_counts.rbegin(); s_it != sorted_counts.rend(); ++s_it)
     {
-      unsigned int h = s_it->second; // Motif hash.
+      const MotifId& h = *s_it->second; // Motif identity.
 		
       unsigned int data_count = this->count(h);
       const std::vector<T>& ref_counts = this->counts(h);
@@ -249,6 +270,7 @@ bool ReferenceMotifCounter<T>::print(const std::string& fileName) const
 	     << std::setw(12) << N_loc_tot
 	     << std::setw(12) << N_loc
 	     << std::setw(fw) << std::setiosflags(std::ios::fixed) << std::setprecision(2) << N_loc_ref
+	     << std::setw(10) << this->motif_id(h)
 	     << this->desc(h) << std::endl;
     }
 	
@@ -273,7 +295,7 @@ bool SingleRefMotifCounter<T>::print(const std::string& fileName) const
   /* Sort the map keys by count in the actual data so they can be
      easily printed in sorted order. (The multimap is automatically
      sorted by its key.) */
-  std::multimap<unsigned int, unsigned int> sorted_counts;
+  std::multimap<unsigned int, const MotifId*> sorted_counts;
   this->sort_by_count(sorted_counts);
   
   /* Open output stream. */
@@ -293,10 +315,10 @@ bool SingleRefMotifCounter<T>::print(const std::string& fileName) const
 	 << "ratio         "
 	 << "N [node:color ...] edges ...\n";
 	
-  std::multimap<unsigned int, unsigned int>::reverse_iterator s_it;
+  std::multimap<unsigned int, const MotifId*>::reverse_iterator s_it;
   for (s_it = sorted_counts.rbegin(); s_it != sorted_counts.rend(); ++s_it)
     {
-      unsigned int h = s_it->second; // Motif hash.
+      const MotifId& h = *s_it->second; // Motif identity.
 		
       unsigned int data_count = this->count(h);
       T ref_count = this->counts(h)[0];
@@ -331,7 +353,7 @@ bool DistributionMotifCounter<T>::print(const std::string& fileName) const
   /* Sort the map keys by total count so they can be easily printed in
      sorted order. (The multimap is automatically sorted by its
      key.) */
-  std::multimap<T, unsigned int> sorted_counts;
+  std::multimap<T, const MotifId*> sorted_counts;
   this->sort_by_ref_count(sorted_counts);
 
   /* Open output stream. */
@@ -344,10 +366,10 @@ bool DistributionMotifCounter<T>::print(const std::string& fileName) const
     }
 
   /* Print output. */
-  typename std::multimap<T, unsigned int>::reverse_iterator s_it;
+  typename std::multimap<T, const MotifId*>::reverse_iterator s_it;
   for (s_it = sorted_counts.rbegin(); s_it != sorted_counts.rend(); ++s_it)
     {
-      unsigned int h = s_it->second; // Motif hash.
+      const MotifId& h = *s_it->second; // Motif identity.
 
       // Print counts separated by commas.
       const std::vector<T>& ref_counts = this->counts(h);      
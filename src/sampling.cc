@@ -0,0 +1,149 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <math.h>
+#include <stdio.h>
+#include "sampling.h"
+#include "std_printers.h"
+
+MotifEstimator::MotifEstimator(const std::vector<unsigned int>& N_roots)
+  : samples(),
+    N_roots(N_roots),
+    n_roots(N_roots.size(), 0)
+{}
+
+double MotifEstimator::weight(unsigned int i_stratum) const
+{
+  if (n_roots[i_stratum] == 0) return 0;
+  return ((double)N_roots[i_stratum])/n_roots[i_stratum];
+}
+
+void MotifEstimator::add_motif(const MotifId& id, Motif* m, unsigned int motif_id)
+{
+  MotifSample& ms = samples[id];
+  if (ms.desc.empty())
+    {
+      ms.desc = to_string(*m);
+      ms.motif_id = motif_id;
+      ms.sum.resize(N_roots.size());
+      ms.sum_sq.resize(N_roots.size());
+    }
+}
+
+void MotifEstimator::add_root(unsigned int i_stratum, const std::map<MotifId, unsigned int>& counts)
+{
+  n_roots[i_stratum]++;
+  std::map<MotifId, unsigned int>::const_iterator it;
+  for (it = counts.begin(); it != counts.end(); ++it)
+    {
+      MotifSample& ms = samples.find(it->first)->second;
+      double y = it->second;
+      ms.count += it->second;
+      ms.sum[i_stratum] += y;
+      ms.sum_sq[i_stratum] += y*y;
+    }
+}
+
+void MotifEstimator::add(const MotifEstimator& other)
+{
+  for (unsigned int h = 0; h < N_roots.size(); ++h) n_roots[h] += other.n_roots[h];
+  for (MotifSampleMap::const_iterator it = other.samples.begin(); it != other.samples.end(); ++it)
+    {
+      MotifSample& ms = samples[it->first];
+      if (ms.desc.empty())
+	{
+	  ms.desc = it->second.desc;
+	  ms.motif_id = it->second.motif_id;
+	  ms.sum.resize(N_roots.size());
+	  ms.sum_sq.resize(N_roots.size());
+	}
+      ms.count += it->second.count;
+      for (unsigned int h = 0; h < N_roots.size(); ++h)
+	{
+	  ms.sum[h] += it->second.sum[h];
+	  ms.sum_sq[h] += it->second.sum_sq[h];
+	}
+    }
+}
+
+double MotifEstimator::estimate(const MotifId& id) const
+{
+  const MotifSample& ms = samples.find(id)->second;
+  double est = 0;
+  for (unsigned int h = 0; h < N_roots.size(); ++h) est += weight(h)*ms.sum[h];
+  return est;
+}
+
+double MotifEstimator::variance(const MotifId& id) const
+{
+  const MotifSample& ms = samples.find(id)->second;
+  double var = 0;
+  for (unsigned int h = 0; h < N_roots.size(); ++h)
+    {
+      // Roots without this motif count as zeros in the sample.
+      double n = n_roots[h];
+      if (n < 2) continue;
+      double mean = ms.sum[h]/n;
+      double s2 = (ms.sum_sq[h] - n*mean*mean)/(n-1);
+      if (s2 < 0) s2 = 0;
+      double N = N_roots[h];
+      var += N*N*(1-n/N)*s2/n;
+    }
+  return var;
+}
+
+bool MotifEstimator::print(const std::string& fileName) const
+{
+  std::multimap<double, const MotifId*> sorted_estimates;
+  for (MotifSampleMap::const_iterator it = samples.begin(); it != samples.end(); ++it)
+    {
+      sorted_estimates.insert(std::make_pair(estimate(it->first), &it->first));
+    }
+
+  std::cout << "Writing estimates to file " << std::endl;
+  std::cout << "   " << fileName.c_str() << std::endl;
+
+  std::ofstream output;
+  output.open(fileName.c_str());
+  if (output.fail())
+    {
+      perror("Failed to open output file");
+      return false;
+    }
+
+  unsigned int fw = 14; // field width
+  unsigned int fp = 2; // field precision
+  output << "estimate      "
+	 << "std_err       "
+	 << "ci_low        "
+	 << "ci_high       "
+	 << "N_sampled "
+	 << "motif_id  "
+	 << "N [node:color ...] edges ..." << std::endl;
+
+  std::multimap<double, const MotifId*>::const_reverse_iterator s_it;
+  for (s_it = sorted_estimates.rbegin(); s_it != sorted_estimates.rend(); ++s_it)
+    {
+      const MotifSample& ms = samples.find(*s_it->second)->second;
+      double est = s_it->first;
+      double std_err = sqrt(variance(*s_it->second));
+      double ci_low = est - 1.96*std_err;
+      if (ci_low < 0) ci_low = 0;
+      output << std::setiosflags(std::ios::left) << std::setiosflags(std::ios::fixed) << std::setprecision(fp)
+	     << std::setw(fw) << est
+	     << std::setw(fw) << std_err
+	     << std::setw(fw) << ci_low
+	     << std::setw(fw) << est + 1.96*std_err
+	     << std::setw(10) << ms.count
+	     << std::setw(10) << ms.motif_id
+	     << ms.desc << std::endl;
+    }
+
+  output.close();
+  if (output.fail())
+    {
+      perror("Failed to close output file");
+      return false;
+    }
+  return true;
+}
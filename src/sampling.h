@@ -0,0 +1,74 @@
+/*
+Estimate motif counts from a sample of root events.
+
+The root events are divided into strata, and a simple random sample
+is taken in each stratum. A subgraph is found exactly when its first
+event is sampled, so the total count of a motif is estimated by
+weighting the subgraphs of each sampled root event by N_h/n_h, where
+N_h is the number of root events in stratum h and n_h the number of
+sampled ones. The variance is that of the stratified estimator of a
+total:
+
+   Var = sum_h N_h^2 (1 - n_h/N_h) s_h^2 / n_h,
+
+where s_h^2 is the sample variance of the number of subgraphs per
+root event in stratum h.
+*/
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include "motif.h"
+
+class MotifEstimator
+{
+ private:
+  struct MotifSample
+  {
+    std::string desc;
+    unsigned int motif_id; // Catalogue id of the untyped motif.
+    unsigned int count; // Number of subgraphs in the sample.
+    std::vector<double> sum;    // Sum of subgraphs per root in each stratum.
+    std::vector<double> sum_sq; // Sum of squares of the same.
+    MotifSample() : desc(), motif_id(0), count(0), sum(), sum_sq() {};
+  };
+  typedef std::map<MotifId, MotifSample> MotifSampleMap;
+
+  MotifSampleMap samples;
+  std::vector<unsigned int> N_roots; // Root events in each stratum.
+  std::vector<unsigned int> n_roots; // Sampled root events in each stratum.
+
+ public:
+  MotifEstimator(const std::vector<unsigned int>& N_roots);
+
+  /* Weight of the subgraphs of a sampled root event in stratum
+     'i_stratum'. Returns 0 if the stratum has no sampled roots. */
+  double weight(unsigned int i_stratum) const;
+
+  /* Add a sampled root event in stratum 'i_stratum'. 'counts' gives
+     the number of subgraphs of each motif (by identity) with this
+     root event. The motifs must have been added with add_motif(). */
+  void add_root(unsigned int i_stratum, const std::map<MotifId, unsigned int>& counts);
+
+  /* Add the sampled root events and motifs of 'other', which has the
+     same strata. This allows each thread to collect its own sample. */
+  void add(const MotifEstimator& other);
+
+  /* Make the motif known to the estimator. 'id' is the identity of
+     'm' and 'motif_id' the catalogue id of its untyped motif. */
+  void add_motif(const MotifId& id, Motif* m, unsigned int motif_id);
+
+  /* Estimated count of the motif and its variance. */
+  double estimate(const MotifId& id) const;
+  double variance(const MotifId& id) const;
+
+  /* Print the estimates with standard errors and 95 % confidence
+     intervals (normal approximation) in decreasing order of the
+     estimate. */
+  bool print(const std::string& fileName) const;
+};
+
+#endif
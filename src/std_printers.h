@@ -28,6 +28,9 @@ void invert_vector(std::vector<T>& v)
     }
 }
 
+template <class V1, class V2>
+std::ostream& operator<<(std::ostream& output, const std::pair<V1,V2>& p);
+
 /* Turn any printable object into a string. */
 template <class T>
 inline std::string to_string(const T& t)
@@ -0,0 +1,890 @@
+/* Tests for finding and identifying temporal motifs.
+ *
+ * Usage: test_motifs [TEST ...]
+ *
+ * Runs the given tests, or all of them if none is given. Each test
+ * prints 'ok' or what went wrong, and the exit status is non-zero if
+ * some test fails. The tests are
+ *
+ *   keys    : the labelled key of every connected untyped motif with
+ *             at most 6 events is the same for any labelling of the
+ *             nodes, and different keys give different canonical forms.
+ *   threads : canonical forms found in parallel, with a MotifCanonizer
+ *             for each thread and through a shared MotifCache, are the
+ *             same as those found serially with Motif::get_id().
+ *   project : the key of the typed motif projected with
+ *             TSubgraph::project_key() is the same as the labelled key
+ *             with the same types, for all four combinations of types.
+ *   components : the maximal subgraph ids of random events, labelled
+ *             in parallel segments by 1 to 16 threads, are the same as
+ *             those found by joining all pairs of events that share a
+ *             node and are at most the time window apart.
+ *   hierarchy : the ids of a ComponentHierarchy for several time
+ *             windows are the same as those found separately for each
+ *             time window.
+ *   streaming : the maximal subgraphs handed over one by one by
+ *             Events::stream_maximal_subgraphs() are the same as those
+ *             found by grouping all events by their subgraph ids.
+ *   enumerate : the subgraphs of small random events found by
+ *             TSubgraphFinder, and their time windows, are the same as
+ *             those found by trying all connected sets of events, for
+ *             each maximum size and with and without limits on the
+ *             numbers of nodes and edges.
+ *   locations : the locations of a LocationMap, their order and counts
+ *             are the same as in a std::map after adding, growing,
+ *             merging, swapping and clearing.
+ *   edges   : packed edges keep their nodes and types and their order
+ *             with the layouts chosen by Edge::set_range() for
+ *             several type ranges, up to the largest node id that
+ *             fits, and one node more is rejected.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <set>
+#include <map>
+#include <vector>
+#include "tsubgraph.h"
+#include "motif_cache.h"
+#include "location_map.h"
+#include "std_printers.h"
+
+// Event sequence of an untyped motif: fr_1 to_1 fr_2 to_2 ...
+typedef std::vector<unsigned int> EventSeq;
+
+/* Find all connected event sequences with 'nof_events' events where
+   the nodes are labelled in the order of first appearance, like
+   MotifCatalogue does, and call 'check' for each. */
+template <class Check>
+void enumerate(EventSeq& seq, unsigned int nof_nodes, unsigned int nof_events, Check& check)
+{
+  if (seq.size() == 2*nof_events)
+    {
+      std::vector<unsigned int> comp(nof_nodes);
+      for (unsigned int i = 0; i < nof_nodes; ++i) comp[i] = i;
+      for (unsigned int i = 0; i < seq.size(); i += 2)
+	{
+	  unsigned int c_fr = comp[seq[i]], c_to = comp[seq[i+1]];
+	  for (unsigned int j = 0; j < nof_nodes; ++j) if (comp[j] == c_to) comp[j] = c_fr;
+	}
+      for (unsigned int i = 1; i < nof_nodes; ++i) if (comp[i] != comp[0]) return;
+      check(seq, nof_nodes);
+      return;
+    }
+
+  for (unsigned int fr = 0; fr <= nof_nodes; ++fr)
+    {
+      unsigned int max_to = (fr == nof_nodes ? nof_nodes + 1 : nof_nodes);
+      for (unsigned int to = 0; to <= max_to; ++to)
+	{
+	  if (to == fr) continue;
+	  seq.push_back(fr);
+	  seq.push_back(to);
+	  enumerate(seq, std::max(nof_nodes, std::max(fr, to) + 1), nof_events, check);
+	  seq.resize(seq.size() - 2);
+	}
+    }
+}
+
+/* Check the key and the canonical form of a single untyped motif. The
+   nodes get random distinct ids, so the key must undo the
+   labelling. */
+class KeyCheck
+{
+ private:
+  std::vector<unsigned short int> node_types;
+  std::vector<node_id> node_ids;
+  MotifCanonizer c;
+
+ public:
+  std::set<MotifId> ids; // Canonical forms seen so far.
+  unsigned int nof_motifs;
+  unsigned int nof_errors;
+
+  KeyCheck() : node_types(100, 0), node_ids(), c(), ids(), nof_motifs(0), nof_errors(0)
+  {
+    for (node_id i = 0; i < node_types.size(); ++i) node_ids.push_back(i);
+  };
+
+  void operator()(const EventSeq& seq, unsigned int nof_nodes)
+  {
+    nof_motifs++;
+    for (unsigned int i = 0; i < nof_nodes; ++i)
+      {
+	std::swap(node_ids[i], node_ids[i + rand()%(node_ids.size() - i)]);
+      }
+    EdgeVector edges;
+    for (unsigned int i = 0; i < seq.size(); i += 2)
+      {
+	edges.push_back(Edge(node_ids[seq[i]], node_ids[seq[i+1]], 1 + rand()%3));
+      }
+    TSubgraph sg(edges, node_types);
+
+    MotifKey key, expected(1, nof_nodes);
+    expected.resize(nof_nodes + 1, 0);
+    for (unsigned int i = 0; i < seq.size(); i += 2)
+      {
+	expected.push_back(seq[i]);
+	expected.push_back(seq[i+1]);
+	expected.push_back(1);
+      }
+    sg.get_labelled_key(false, false, key);
+    if (key != expected)
+      {
+	if (nof_errors++ < 10) std::cout << "   Wrong key for " << edges << "\n";
+      }
+
+    MotifId id;
+    sg.canonize(c, false, false, false);
+    c.get_id(id);
+    if (!ids.insert(id).second)
+      {
+	if (nof_errors++ < 10) std::cout << "   Canonical form of " << edges << " is not unique\n";
+      }
+  };
+};
+
+bool test_keys()
+{
+  // Numbers of connected untyped motifs with 1 to 6 events.
+  const unsigned int nof_motifs[] = {1, 6, 68, 1240, 32272, 1115040};
+  bool ok = true;
+  for (unsigned int k = 1; k <= 6; ++k)
+    {
+      // Motifs with different numbers of events differ anyway, so the
+      // canonical forms are compared for each number of events.
+      KeyCheck check;
+      EventSeq seq;
+      enumerate(seq, 0, k, check);
+      if (check.nof_motifs != nof_motifs[k-1])
+	{
+	  std::cout << "   Found " << check.nof_motifs << " motifs with " << k
+		    << " events instead of " << nof_motifs[k-1] << ".\n";
+	  ok = false;
+	}
+      if (check.nof_errors) ok = false;
+    }
+  return ok;
+}
+
+/* Random subgraph with 1 to 6 events between 7 nodes. */
+TSubgraph* random_subgraph(const std::vector<unsigned short int>& node_types)
+{
+  EdgeVector edges;
+  unsigned int k = 1 + rand()%6;
+  for (unsigned int i = 0; i < k; ++i)
+    {
+      node_id fr = rand()%7, to = rand()%6;
+      if (to >= fr) to++;
+      edges.push_back(Edge(fr, to, 1 + rand()%2));
+    }
+  return new TSubgraph(edges, node_types);
+}
+
+bool test_threads()
+{
+  const unsigned int nof_subgraphs = 20000, nof_rounds = 10;
+
+  // Node types are different from the event types.
+  std::vector<unsigned short int> node_types(7);
+  for (unsigned int i = 0; i < node_types.size(); ++i) node_types[i] = 40 + rand()%3;
+  std::vector<TSubgraph*> subgraphs;
+  for (unsigned int i = 0; i < nof_subgraphs; ++i) subgraphs.push_back(random_subgraph(node_types));
+
+  // Untyped and typed identities of each subgraph, found serially.
+  std::vector<MotifId> ids(2*nof_subgraphs);
+  std::vector<std::string> descs(nof_subgraphs);
+  for (unsigned int i = 0; i < nof_subgraphs; ++i)
+    {
+      for (unsigned int typed = 0; typed < 2; ++typed)
+	{
+	  Motif* m = subgraphs[i]->get_motif(typed, typed, false);
+	  m->get_id(ids[2*i + typed]);
+	  if (typed) descs[i] = to_string(*m);
+	  delete m;
+	}
+    }
+
+  // Go through the subgraphs several times in parallel. The cache is
+  // smaller than the number of motifs, so that also the motifs that
+  // are not stored are used. Several threads are used also on a
+  // single core, where they are then interleaved. The cache must be
+  // constructed after setting the number of threads.
+#ifdef _OPENMP
+  if (omp_get_max_threads() < 4) omp_set_num_threads(4);
+  std::cout << "   Using " << omp_get_max_threads() << " threads.\n";
+#endif
+  MotifCache cache(1000);
+  long nof_errors = 0;
+#pragma omp parallel reduction(+:nof_errors)
+  {
+    MotifCanonizer c;
+    MotifId id, cached_id;
+#pragma omp for schedule(dynamic, 64)
+    for (long r = 0; r < (long)(nof_rounds*nof_subgraphs); ++r)
+      {
+	unsigned int i = r % nof_subgraphs;
+	for (unsigned int typed = 0; typed < 2; ++typed)
+	  {
+	    subgraphs[i]->canonize(c, typed, typed, false);
+	    c.get_id(id);
+	    if (!(id == ids[2*i + typed])) nof_errors++;
+	  }
+
+	// The cached motif is shared by the threads.
+	const CachedMotif& cm = cache.get(*subgraphs[i]);
+	cm.motif->get_id(cached_id);
+	if (!(cm.id == ids[2*i + 1]) || !(cached_id == ids[2*i + 1]) ||
+	    to_string(*cm.motif) != descs[i]) nof_errors++;
+      }
+  }
+
+  for (unsigned int i = 0; i < nof_subgraphs; ++i) delete subgraphs[i];
+  if (nof_errors) std::cout << "   " << nof_errors << " motifs differ from the serial ones.\n";
+
+  // Every lookup is either a hit or a miss, and the cache is not
+  // allowed to grow beyond its size.
+  if (cache.size() > 1000 || cache.hits() + cache.misses() != nof_rounds*nof_subgraphs)
+    {
+      std::cout << "   The cache has " << cache.size() << " motifs after "
+		<< cache.hits() << " hits and " << cache.misses() << " misses.\n";
+      nof_errors++;
+    }
+  return (nof_errors == 0);
+}
+
+bool test_project()
+{
+  std::vector<unsigned short int> node_types(7);
+  for (unsigned int i = 0; i < node_types.size(); ++i) node_types[i] = 40 + rand()%3;
+
+  unsigned int nof_errors = 0;
+  for (unsigned int i = 0; i < 100000; ++i)
+    {
+      TSubgraph* sg = random_subgraph(node_types);
+      MotifKey typed_key, key, projected_key;
+      sg->get_labelled_key(true, true, typed_key);
+      for (unsigned int types = 0; types < 4; ++types)
+	{
+	  bool use_node_types = types & 1, use_event_types = types & 2;
+	  sg->get_labelled_key(use_node_types, use_event_types, key);
+	  TSubgraph::project_key(typed_key, use_node_types, use_event_types, projected_key);
+	  if (projected_key != key && nof_errors++ < 10)
+	    {
+	      std::cout << "   Projected key " << projected_key << " differs from " << key
+			<< " (node types " << use_node_types << ", event types " << use_event_types << ").\n";
+	    }
+	}
+      delete sg;
+    }
+  return (nof_errors == 0);
+}
+
+/* Random events in temporal order between 'nof_nodes' nodes, with
+   about one event starting in each time unit. The durations are at
+   most 'max_duration'; with the default 0 the events of a node never
+   overlap. */
+Events* random_events(unsigned int nof_events, unsigned int nof_nodes, unsigned int max_duration = 0)
+{
+  std::ostringstream data;
+  unsigned int t = 0;
+  for (unsigned int i = 0; i < nof_events; ++i)
+    {
+      t += rand()%3;
+      node_id fr = rand()%nof_nodes, to = rand()%(nof_nodes - 1);
+      if (to >= fr) to++;
+      data << t << " " << rand()%(max_duration + 1) << " " << fr << " " << to << "\n";
+    }
+
+  // Keep the constructor from printing.
+  std::istringstream input(data.str());
+  std::ostringstream discard;
+  std::streambuf* cout_buf = std::cout.rdbuf(discard.rdbuf());
+  Events* events = new Events(input);
+  std::cout.rdbuf(cout_buf);
+  return events;
+}
+
+/* Maximal subgraph ids found by joining every pair of events that
+   share a node and are at most 'tw' apart. The id is that of the
+   earliest event of the subgraph. */
+void brute_force_components(const Events& events, unsigned int tw, std::vector<event_id>& ids)
+{
+  ids.resize(events.size());
+  for (event_id i = 0; i < events.size(); ++i) ids[i] = i;
+  for (event_id j = 0; j < events.size(); ++j)
+    {
+      for (event_id i = 0; i < j; ++i)
+	{
+	  const Event& e_i = events[i];
+	  const Event& e_j = events[j];
+	  if (e_i.from() != e_j.from() && e_i.from() != e_j.to() &&
+	      e_i.to() != e_j.from() && e_i.to() != e_j.to()) continue;
+	  if (events.dt(i, j) > tw) continue;
+
+	  // Relabel the later subgraph by the earlier id.
+	  event_id old_id = std::max(ids[i], ids[j]), new_id = std::min(ids[i], ids[j]);
+	  for (event_id k = 0; k <= j; ++k) if (ids[k] == old_id) ids[k] = new_id;
+	}
+    }
+}
+
+bool test_components()
+{
+  // The events are labelled in as many segments as there are threads,
+  // and the subgraphs that continue over the segment boundaries are
+  // joined afterwards.
+  const int nof_threads[] = {1, 2, 3, 4, 7, 16};
+  int max_threads = 1;
+#ifdef _OPENMP
+  max_threads = omp_get_max_threads();
+#endif
+
+  unsigned int nof_errors = 0, nof_crossing = 0;
+  for (unsigned int round = 0; round < 20; ++round)
+    {
+      Events* events = random_events(300 + rand()%300, 10 + rand()%100);
+      unsigned int tw = rand()%20;
+      std::vector<event_id> ids;
+      brute_force_components(*events, tw, ids);
+
+      for (unsigned int i_n = 0; i_n < sizeof(nof_threads)/sizeof(int); ++i_n)
+	{
+	  int n = nof_threads[i_n];
+#ifdef _OPENMP
+	  omp_set_num_threads(n);
+#endif
+	  // Count the segment boundaries inside a maximal subgraph.
+	  for (int i_seg = 1; i_seg < n; ++i_seg)
+	    {
+	      event_id first = (event_id)(((uint64_t)events->size()*i_seg)/n);
+	      if (ids[first] < first) nof_crossing++;
+	    }
+
+	  events->find_maximal_subgraphs(tw);
+	  for (event_id i = 0; i < events->size(); ++i)
+	    {
+	      if ((*events)[i].component() != ids[i] && nof_errors++ < 10)
+		{
+		  std::cout << "   Event " << i << " has id " << (*events)[i].component()
+			    << " instead of " << ids[i] << " with time window " << tw
+			    << " and " << n << " threads.\n";
+		}
+	    }
+	}
+      delete events;
+    }
+#ifdef _OPENMP
+  omp_set_num_threads(max_threads);
+#endif
+
+  if (nof_crossing == 0)
+    {
+      std::cout << "   No maximal subgraph continued over a segment boundary.\n";
+      return false;
+    }
+  return (nof_errors == 0);
+}
+
+bool test_hierarchy()
+{
+  unsigned int nof_errors = 0;
+  for (unsigned int round = 0; round < 20; ++round)
+    {
+      Events* events = random_events(300 + rand()%300, 10 + rand()%100);
+
+      // Up to 8 time windows in any order, possibly with duplicates.
+      std::vector<unsigned int> tws(1 + rand()%8);
+      for (unsigned int i = 0; i < tws.size(); ++i) tws[i] = rand()%30;
+      ComponentHierarchy ch;
+      events->find_maximal_subgraphs(tws, ch);
+
+      for (unsigned int i_tw = 0; i_tw < ch.size(); ++i_tw)
+	{
+	  unsigned int tw = ch.time_window(i_tw);
+	  if (i_tw > 0 && tw <= ch.time_window(i_tw - 1)) nof_errors++;
+	  if (std::find(tws.begin(), tws.end(), tw) == tws.end()) nof_errors++;
+
+	  events->find_maximal_subgraphs(tw);
+	  std::vector<event_id> ids(events->size());
+	  for (event_id i = 0; i < events->size(); ++i) ids[i] = (*events)[i].component();
+
+	  events->set_components(ch, i_tw);
+	  for (event_id i = 0; i < events->size(); ++i)
+	    {
+	      if ((*events)[i].component() != ids[i] && nof_errors++ < 10)
+		{
+		  std::cout << "   Event " << i << " has id " << (*events)[i].component()
+			    << " instead of " << ids[i] << " with time window " << tw
+			    << " of " << tws << ".\n";
+		}
+	    }
+	}
+
+      // The time windows are sorted and duplicates removed.
+      std::sort(tws.begin(), tws.end());
+      if (ch.size() != (unsigned int)(std::unique(tws.begin(), tws.end()) - tws.begin()))
+	{
+	  std::cout << "   The hierarchy has " << ch.size() << " time windows for " << tws << ".\n";
+	  nof_errors++;
+	}
+      delete events;
+    }
+  return (nof_errors == 0);
+}
+
+/* Save the maximal subgraphs handed over by
+   Events::stream_maximal_subgraphs(). */
+class SubgraphCollector : public MaximalSubgraphVisitor
+{
+ public:
+  std::map<event_id, std::pair<unsigned int, std::set<event_id> > > subgraphs;
+  unsigned int nof_repeated;
+
+  SubgraphCollector() : subgraphs(), nof_repeated(0) {};
+
+  void visit(event_id component, unsigned int size, const std::set<event_id>& eventSet)
+  {
+    if (subgraphs.count(component)) nof_repeated++;
+    subgraphs[component] = std::make_pair(size, eventSet);
+  };
+};
+
+bool test_streaming()
+{
+  unsigned int nof_errors = 0;
+  for (unsigned int round = 0; round < 50; ++round)
+    {
+      Events* events = random_events(300 + rand()%300, 10 + rand()%100, rand()%6);
+      unsigned int tw = rand()%20;
+      unsigned int max_size = rand()%6; // 0 means no limit.
+      unsigned int t_start = events->first_time() + rand()%50;
+      unsigned int t_stop = events->last_start_time() - rand()%50;
+      events->find_maximal_subgraphs(tw);
+
+      // All events of each maximal subgraph at once.
+      std::map<event_id, std::set<event_id> > batch;
+      for (Events::const_iterator e_it = events->begin(); e_it != events->end(); ++e_it)
+	{
+	  if (e_it->start_time() < t_start || e_it->start_time() > t_stop) continue;
+	  batch[e_it->component()].insert(e_it->id());
+	}
+
+      SubgraphCollector collector;
+      events->stream_maximal_subgraphs(tw, max_size, t_start, t_stop, collector);
+      if (collector.nof_repeated || collector.subgraphs.size() != batch.size())
+	{
+	  std::cout << "   Found " << collector.subgraphs.size() << " maximal subgraphs ("
+		    << collector.nof_repeated << " repeated) instead of " << batch.size() << ".\n";
+	  nof_errors++;
+	}
+      std::map<event_id, std::set<event_id> >::const_iterator b_it;
+      for (b_it = batch.begin(); b_it != batch.end(); ++b_it)
+	{
+	  if (!collector.subgraphs.count(b_it->first)) continue;
+	  const std::pair<unsigned int, std::set<event_id> >& sg = collector.subgraphs[b_it->first];
+	  bool too_large = (max_size && b_it->second.size() > max_size);
+	  if ((sg.first != b_it->second.size() ||
+	       sg.second != (too_large ? std::set<event_id>() : b_it->second)) && nof_errors++ < 10)
+	    {
+	      std::cout << "   Maximal subgraph " << b_it->first << " has " << sg.first
+			<< " events instead of " << b_it->second.size() << ".\n";
+	    }
+	}
+      delete events;
+    }
+  return (nof_errors == 0);
+}
+
+/* Save the subgraphs given by a TSubgraphFinder with their time
+   windows. */
+class TSubgraphCollector : public TSubgraphVisitor
+{
+ public:
+  std::map<EventVector, unsigned int> subgraphs;
+  unsigned int nof_repeated;
+
+  TSubgraphCollector() : subgraphs(), nof_repeated(0) {};
+
+  void visit(const EventVector& eventVector, const EdgeVector& edges, unsigned int dt_max)
+  {
+    if (subgraphs.count(eventVector)) nof_repeated++;
+    subgraphs[eventVector] = dt_max;
+  };
+};
+
+/* Check that the events have at most 'max_nodes' nodes and
+   'max_edges' edges (0 means no limit). Events between the same two
+   nodes with the same type are on the same edge. */
+bool is_within_limits(const Events& events, const EventVector& ev,
+		      unsigned int max_nodes, unsigned int max_edges)
+{
+  if (!max_nodes && !max_edges) return true;
+  std::set<node_id> nodes;
+  std::set<std::pair<std::pair<node_id, node_id>, short> > edgeSet;
+  for (size_t i = 0; i < ev.size(); ++i)
+    {
+      const Event& e = events[ev[i]];
+      nodes.insert(e.from());
+      nodes.insert(e.to());
+      edgeSet.insert(std::make_pair(std::make_pair(std::min(e.from(), e.to()),
+						   std::max(e.from(), e.to())), e.type()));
+    }
+  return ((!max_nodes || nodes.size() <= max_nodes) && (!max_edges || edgeSet.size() <= max_edges));
+}
+
+/* All valid subgraphs whose first event is 'root' and that have at
+   most 'max_size' events, 'max_nodes' nodes and 'max_edges' edges (0
+   means no limit), with the smallest time window with which each of
+   them is connected. Two events are adjacent if they are consecutive
+   events of a node. The connected sets of events are found by adding
+   adjacent events one at a time, as long as the limits allow, and
+   each of them is then checked with TSubgraph::check_validity(). */
+void brute_force_subgraphs(const Events& events, event_id root, unsigned int tw,
+			   unsigned int max_size, unsigned int max_nodes, unsigned int max_edges,
+			   std::map<EventVector, unsigned int>& subgraphs)
+{
+  // The time differences of adjacent events, both ways.
+  std::vector<std::map<event_id, unsigned int> > adjacent(events.size());
+  std::map<node_id, event_id> last;
+  for (event_id i = 0; i < events.size(); ++i)
+    {
+      node_id nodes[2] = {events[i].from(), events[i].to()};
+      for (int k = 0; k < 2; ++k)
+	{
+	  if (last.count(nodes[k]))
+	    {
+	      event_id j = last[nodes[k]];
+	      adjacent[i][j] = adjacent[j][i] = events.dt(j, i);
+	    }
+	  last[nodes[k]] = i;
+	}
+    }
+
+  std::set<EventVector> found;
+  std::vector<EventVector> queue(1, EventVector(1, root));
+  found.insert(queue[0]);
+  for (size_t i_q = 0; i_q < queue.size(); ++i_q)
+    {
+      const EventVector ev = queue[i_q];
+      if (max_size && ev.size() == max_size) continue;
+      for (size_t i = 0; i < ev.size(); ++i)
+	{
+	  std::map<event_id, unsigned int>::const_iterator it;
+	  for (it = adjacent[ev[i]].begin(); it != adjacent[ev[i]].end(); ++it)
+	    {
+	      if (it->first <= root || it->second > tw) continue;
+	      if (std::find(ev.begin(), ev.end(), it->first) != ev.end()) continue;
+	      EventVector larger(ev);
+	      larger.insert(std::upper_bound(larger.begin(), larger.end(), it->first), it->first);
+	      if (!is_within_limits(events, larger, max_nodes, max_edges)) continue;
+	      if (found.insert(larger).second) queue.push_back(larger);
+	    }
+	}
+    }
+
+  subgraphs.clear();
+  for (std::set<EventVector>::const_iterator s_it = found.begin(); s_it != found.end(); ++s_it)
+    {
+      const EventVector& ev = *s_it;
+      EdgeVector edges;
+      if (!TSubgraph::check_validity(events, ev, edges)) continue;
+
+      if (!is_within_limits(events, ev, max_nodes, max_edges)) continue;
+
+      // The time window is the largest time difference needed to
+      // connect the events, found by always adding the closest event.
+      unsigned int dt_max = 0;
+      std::vector<bool> added(ev.size(), false);
+      added[0] = true;
+      for (size_t n = 1; n < ev.size(); ++n)
+	{
+	  size_t i_best = 0;
+	  unsigned int dt_best = tw + 1;
+	  for (size_t i = 0; i < ev.size(); ++i)
+	    {
+	      if (!added[i]) continue;
+	      for (size_t j = 0; j < ev.size(); ++j)
+		{
+		  if (added[j] || !adjacent[ev[i]].count(ev[j])) continue;
+		  unsigned int dt = adjacent[ev[i]].find(ev[j])->second;
+		  if (dt < dt_best)
+		    {
+		      dt_best = dt;
+		      i_best = j;
+		    }
+		}
+	    }
+	  added[i_best] = true;
+	  dt_max = std::max(dt_max, dt_best);
+	}
+      subgraphs[ev] = dt_max;
+    }
+}
+
+bool test_enumerate()
+{
+  // Maximum subgraph sizes: 2 to 8 are searched with a fixed depth,
+  // 0 (no limit) and 9 with the size checked at run time.
+  const unsigned int max_sizes[] = {0, 2, 3, 4, 5, 6, 7, 8, 9};
+  std::vector<unsigned short int> node_types;
+
+  unsigned int nof_errors = 0, nof_subgraphs = 0;
+  for (unsigned int round = 0; round < 100; ++round)
+    {
+      Events* events = random_events(10 + rand()%25, 3 + rand()%5);
+      unsigned int tw = 1 + rand()%3;
+      events->find_maximal_subgraphs(tw);
+
+      // Every other round limits the nodes and edges (0 means no limit).
+      unsigned int max_nodes = 0, max_edges = 0;
+      if (round % 2)
+	{
+	  max_nodes = rand()%5;
+	  max_edges = rand()%5;
+	}
+
+      for (unsigned int i_s = 0; i_s < sizeof(max_sizes)/sizeof(max_sizes[0]); ++i_s)
+	{
+	  unsigned int max_size = max_sizes[i_s];
+	  TSubgraphFinder sgf(0, tw, max_size, *events, node_types);
+	  sgf.set_limits(max_nodes, max_edges);
+	  for (event_id root = 0; root < events->size(); ++root)
+	    {
+	      std::map<EventVector, unsigned int> expected;
+	      brute_force_subgraphs(*events, root, tw, max_size, max_nodes, max_edges, expected);
+	      nof_subgraphs += expected.size();
+
+	      // The full search, and the same search split into branches.
+	      TSubgraphCollector full, branches;
+	      sgf.find_subgraphs(root, full);
+	      for (unsigned int i_branch = 0; i_branch < TSubgraphFinder::max_branches; ++i_branch)
+		{
+		  sgf.find_subgraphs(root, i_branch, branches);
+		}
+	      if ((full.subgraphs != expected || full.nof_repeated ||
+		   branches.subgraphs != expected || branches.nof_repeated) && nof_errors++ < 10)
+		{
+		  std::cout << "   Found " << full.subgraphs.size() << " and " << branches.subgraphs.size()
+			    << " subgraphs (" << full.nof_repeated + branches.nof_repeated
+			    << " repeated) instead of " << expected.size() << " from root " << root
+			    << " with time window " << tw << ", maximum size " << max_size
+			    << " and at most " << max_nodes << " nodes and " << max_edges << " edges.\n";
+		}
+	    }
+	}
+      delete events;
+    }
+  if (nof_subgraphs == 0) nof_errors++;
+  return (nof_errors == 0);
+}
+
+/* Random location of 0 to 4 edges between 'nof_nodes' nodes with
+   types 0 to 2. */
+EdgeVector random_location(unsigned int nof_nodes)
+{
+  EdgeVector edges(rand()%5);
+  for (size_t i = 0; i < edges.size(); ++i)
+    {
+      edges[i] = Edge(rand()%nof_nodes, rand()%nof_nodes, rand()%3);
+    }
+  return edges;
+}
+
+/* Add 'k' to the count of 'edges' both in the LocationMap and in the
+   reference map, and keep the order in which the locations were
+   first added. */
+void add_location(const EdgeVector& edges, unsigned int k, LocationMap& locationMap,
+		  std::map<EdgeVector, unsigned int>& counts, std::vector<EdgeVector>& order)
+{
+  if (!counts.count(edges)) order.push_back(edges);
+  counts[edges] += k;
+  locationMap[edges] += k;
+}
+
+/* Check that the locations, their order and counts are those of the
+   reference map. */
+bool same_locations(const LocationMap& locationMap, const std::map<EdgeVector, unsigned int>& counts,
+		    const std::vector<EdgeVector>& order)
+{
+  if (locationMap.size() != counts.size() || order.size() != counts.size()) return false;
+  EdgeVector edges;
+  for (size_t i = 0; i < locationMap.size(); ++i)
+    {
+      locationMap.get_edges(i, edges);
+      if (edges != order[i] || locationMap.count(i) != counts.find(edges)->second ||
+	  locationMap.get_count(edges) != locationMap.count(i)) return false;
+    }
+  return true;
+}
+
+bool test_locations()
+{
+  typedef std::map<EdgeVector, unsigned int> CountMap;
+  unsigned int nof_errors = 0;
+  for (unsigned int round = 0; round < 20; ++round)
+    {
+      // Few nodes give mostly repeated locations, many nodes mostly
+      // new ones, so that the table grows many times.
+      unsigned int nof_nodes = 2 + rand()%(round < 10 ? 5 : 1000);
+      LocationMap locations, other;
+      CountMap counts, other_counts;
+      std::vector<EdgeVector> order, other_order;
+      unsigned int nof_lookups = rand()%20000;
+      for (unsigned int i = 0; i < nof_lookups; ++i)
+	{
+	  EdgeVector edges = random_location(nof_nodes);
+	  unsigned int k = rand()%3;
+	  if (rand()%2) add_location(edges, k, locations, counts, order);
+	  else add_location(edges, k, other, other_counts, other_order);
+
+	  // Locations that are not in the map have count 0.
+	  edges = random_location(nof_nodes);
+	  CountMap::const_iterator c_it = counts.find(edges);
+	  if (locations.get_count(edges) != (c_it == counts.end() ? 0 : c_it->second)) nof_errors++;
+	}
+      if (!same_locations(locations, counts, order) || !same_locations(other, other_counts, other_order))
+	{
+	  if (nof_errors++ < 10) std::cout << "   Wrong locations after " << nof_lookups << " lookups.\n";
+	}
+
+      // Adding the other map keeps the order of both.
+      for (size_t i = 0; i < other_order.size(); ++i)
+	{
+	  if (!counts.count(other_order[i])) order.push_back(other_order[i]);
+	  counts[other_order[i]] += other_counts[other_order[i]];
+	}
+      locations.add(other);
+      if (!same_locations(locations, counts, order) && nof_errors++ < 10)
+	{
+	  std::cout << "   Wrong locations after adding " << other.size() << " locations.\n";
+	}
+
+      // Swapping with an empty map, clearing and using it again.
+      LocationMap swapped;
+      swapped.swap(locations);
+      if ((!same_locations(swapped, counts, order) || locations.size() != 0 ||
+	   (!order.empty() && locations.get_count(order[0]) != 0)) && nof_errors++ < 10)
+	{
+	  std::cout << "   Wrong locations after swapping.\n";
+	}
+      swapped.clear();
+      counts.clear();
+      order.clear();
+      if (!same_locations(swapped, counts, order)) nof_errors++;
+      add_location(random_location(nof_nodes), 1 + rand()%3, swapped, counts, order);
+      if (!same_locations(swapped, counts, order)) nof_errors++;
+    }
+  return (nof_errors == 0);
+}
+
+bool test_edges()
+{
+  // Type ranges that need 0, 1, 8, 9 and 16 bits.
+  const short int type_ranges[][2] = {{0, 0}, {5, 5}, {0, 1}, {-3, -2}, {0, 255}, {-100, 155},
+				      {0, 256}, {std::numeric_limits<short int>::min(), 0},
+				      {std::numeric_limits<short int>::min(), std::numeric_limits<short int>::max()}};
+  unsigned int nof_errors = 0;
+  for (unsigned int i_r = 0; i_r < sizeof(type_ranges)/sizeof(type_ranges[0]); ++i_r)
+    {
+      short int min_type = type_ranges[i_r][0], max_type = type_ranges[i_r][1];
+      unsigned int type_bits = 0;
+      while (((int)max_type - min_type) >> type_bits) type_bits++;
+      unsigned int node_bits = (64 - type_bits)/2;
+      node_id max_node = (node_bits >= 32 ? std::numeric_limits<node_id>::max() :
+			  (node_id)((((uint64_t)1) << node_bits) - 1));
+
+      // One more node than fits is rejected without changing the
+      // layout.
+      if (!Edge::set_range(max_node, min_type, max_type) || Edge::node_bits() != node_bits ||
+	  (node_bits < 32 && (Edge::set_range(max_node + 1, min_type, max_type) ||
+			      Edge::node_bits() != node_bits)))
+	{
+	  std::cout << "   Wrong layout for nodes up to " << max_node << " and types "
+		    << min_type << " to " << max_type << ".\n";
+	  nof_errors++;
+	  continue;
+	}
+
+      // The nodes and types are kept, including the extreme ones, and
+      // the edges are ordered by source, target and type.
+      std::vector<Edge> edges;
+      std::vector<std::pair<std::pair<node_id, node_id>, short int> > fields;
+      for (unsigned int i = 0; i < 1000; ++i)
+	{
+	  node_id from = (i%4 == 0 ? max_node : (i%4 == 1 ? 0 : (node_id)(rand()%1000)*(max_node/1000)));
+	  node_id to = (i%3 == 0 ? max_node : (node_id)(rand()%1000)*(max_node/1000));
+	  short int type = (i%5 == 0 ? max_type : (i%5 == 1 ? min_type :
+						   (short int)(min_type + rand()%((int)max_type - min_type + 1))));
+	  edges.push_back(Edge(from, to, type));
+	  fields.push_back(std::make_pair(std::make_pair(from, to), type));
+	  const Edge& e = edges.back();
+	  if ((e.from() != from || e.to() != to || e.type() != type) && nof_errors++ < 10)
+	    {
+	      std::cout << "   Edge " << from << "->" << to << ":" << type << " became " << e
+			<< " with types " << min_type << " to " << max_type << ".\n";
+	    }
+	}
+      for (unsigned int i = 1; i < edges.size(); ++i)
+	{
+	  if ((edges[i-1] < edges[i]) != (fields[i-1] < fields[i]) ||
+	      (edges[i-1] == edges[i]) != (fields[i-1] == fields[i])) nof_errors++;
+	}
+    }
+
+  // Restore the default layout for the other tests.
+  if (!Edge::set_range((1 << 24) - 1, std::numeric_limits<short int>::min(),
+		       std::numeric_limits<short int>::max()) ||
+      Edge::node_bits() != 24 || Edge::type_bits() != 16) nof_errors++;
+  return (nof_errors == 0);
+}
+
+struct Test
+{
+  const char* name;
+  bool (*run)();
+};
+
+const Test tests[] = {
+  {"keys", test_keys},
+  {"threads", test_threads},
+  {"project", test_project},
+  {"components", test_components},
+  {"hierarchy", test_hierarchy},
+  {"streaming", test_streaming},
+  {"enumerate", test_enumerate},
+  {"locations", test_locations},
+  {"edges", test_edges}
+};
+const unsigned int nof_tests = sizeof(tests)/sizeof(tests[0]);
+
+int main(int argc, char *argv[])
+{
+  for (int j = 1; j < argc; ++j)
+    {
+      unsigned int i = 0;
+      while (i < nof_tests && strcmp(argv[j], tests[i].name) != 0) ++i;
+      if (i == nof_tests)
+	{
+	  std::cout << "Unknown test '" << argv[j] << "'.\n";
+	  return 1;
+	}
+    }
+
+  srand(1);
+  unsigned int nof_failed = 0;
+  for (unsigned int i = 0; i < nof_tests; ++i)
+    {
+      bool selected = (argc == 1);
+      for (int j = 1; j < argc; ++j) if (strcmp(argv[j], tests[i].name) == 0) selected = true;
+      if (!selected) continue;
+
+      std::cout << tests[i].name << ":\n";
+      bool ok = tests[i].run();
+      std::cout << "   " << (ok ? "ok" : "FAILED") << std::endl;
+      if (!ok) nof_failed++;
+    }
+  return (nof_failed ? 1 : 0);
+}
@@ -4,6 +4,7 @@
  */
 #include <queue>
 #include <iostream>
+#include <algorithm>
 #include "events.h"
 #include "tsubgraph.h"
 
@@ -22,7 +23,7 @@ TSubgraph::TSubgraph(Events const& events,
      __is_valid(false)
 {
   // Construct edgeVector and eventTypes.
-  __is_valid = check_validity(events, eventSet);
+  __is_valid = check_validity(events, EventVector(eventSet.begin(), eventSet.end()), edgeVector);
 }
 
 TSubgraph::TSubgraph(const EdgeVector& edgeVector,
@@ -52,54 +53,89 @@ TSubgraph::TSubgraph(TSubgraph const& sg)
 {}
 
 
-unsigned int TSubgraph::add_event_to_motif(Motif& g, node_id fr, node_id to, int prev_ge_id,
-					   std::map<node_id, unsigned int>& nodeMap,
-					   unsigned int e_type, unsigned int fr_type, unsigned int to_type,
-					   bool is_static) const
+void TSubgraph::canonize(MotifCanonizer& c, bool use_node_types, bool use_event_types, bool is_static) const
 {
-  // Add new node vertices if necessary, collecting the node labels.
-  if (nodeMap.find(fr) == nodeMap.end()) nodeMap[fr] = g.add_vertex(fr_type);
-  if (nodeMap.find(to) == nodeMap.end()) nodeMap[to] = g.add_vertex(to_type);
-  // Add new event vertex.
-  unsigned int ge_id = g.add_vertex(e_type);
-  // Add edges between the node vertices and event vertex.
-  g.add_edge(nodeMap[fr], ge_id);
-  g.add_edge(ge_id, nodeMap[to]);
-  // Add edge from previous event vertex if there is one (and we are
-  // not constructing a static motif).
-  if (prev_ge_id && !is_static) g.add_edge(prev_ge_id, ge_id);
-  return ge_id;
+  /* Build a directed graph that includes information about the
+   * temporal order of all events (irregardless of whether they are
+   * adjacent). The node vertices are numbered in the order of first
+   * appearance, and the event vertices come after them. Motifs are
+   * small, so the node labels are found by a linear search.
+   */
+  std::vector<unsigned int>& nodes = c.labels;
+  nodes.clear();
+  for (EdgeVector::const_iterator it = edgeVector.begin(); it != edgeVector.end(); ++it)
+    {
+      if (std::find(nodes.begin(), nodes.end(), it->from()) == nodes.end()) nodes.push_back(it->from());
+      if (std::find(nodes.begin(), nodes.end(), it->to()) == nodes.end()) nodes.push_back(it->to());
+    }
+
+  unsigned int N = nodes.size();
+  Motif& g = c.reset(N + edgeVector.size());
+  for (unsigned int i = 0; i < N; ++i) g.change_color(i, (use_node_types ? node_types[nodes[i]] : 0));
+  unsigned int ge_id = N;
+  for (EdgeVector::const_iterator it = edgeVector.begin(); it != edgeVector.end(); ++it, ++ge_id)
+    {
+      // Add edges between the node vertices and event vertex, and
+      // from the previous event vertex if there is one (and we are
+      // not constructing a static motif).
+      g.change_color(ge_id, (use_event_types ? it->type() : 1));
+      g.add_edge(std::find(nodes.begin(), nodes.end(), it->from()) - nodes.begin(), ge_id);
+      g.add_edge(ge_id, std::find(nodes.begin(), nodes.end(), it->to()) - nodes.begin());
+      if (ge_id > N && !is_static) g.add_edge(ge_id - 1, ge_id);
+    }
+  c.canonize();
 }
 
 /* Construct motif and return it. */
 Motif* TSubgraph::get_motif(bool use_node_types, bool use_event_types, bool is_static) const
 {
-  // Create a map of nodes and a temporary graph.
-  Motif g;
-  g.set_splitting_heuristic(Motif::shs_f);
-  g.set_component_recursion(false);
-  std::map<node_id, unsigned int> nodeMap;
-  unsigned int ge_id = 0;
-	
-  /* Build a directed graph that includes information about the
-   * temporal order of all events (irregardless of whether they are
-   * adjacent).
-   */
-  //std::cerr << edgeVector << " " << use_node_types << " " << use_event_types << " " << is_static << std::endl;
+  MotifCanonizer c;
+  canonize(c, use_node_types, use_event_types, is_static);
+  return c.get_motif();
+}
+
+void TSubgraph::get_labelled_key(bool use_node_types, bool use_event_types, MotifKey& key) const
+{
+  // Label the nodes in the order of first appearance. Motifs are
+  // small, so a linear search is faster than a map.
+  std::vector<node_id> nodes;
+  key.resize(3*edgeVector.size());
+  unsigned int i_key = 0;
   for (EdgeVector::const_iterator it = edgeVector.begin(); it != edgeVector.end(); ++it)
     {
-      // Add edge.
-      ge_id = add_event_to_motif(g, it->from, it->to, ge_id, nodeMap, 
-				 (use_event_types ? it->type : 1),
-				 (use_node_types ? node_types[it->from] : 0), 
-				 (use_node_types ? node_types[it->to] : 0),
-				 is_static);
+      node_id ends[2] = {it->from(), it->to()};
+      for (int i = 0; i < 2; ++i)
+	{
+	  unsigned int label = std::find(nodes.begin(), nodes.end(), ends[i]) - nodes.begin();
+	  if (label == nodes.size()) nodes.push_back(ends[i]);
+	  key[i_key++] = label;
+	}
+      key[i_key++] = (use_event_types ? it->type() : 1);
+    }
+
+  // Add the number of nodes and node colors to the beginning.
+  MotifKey node_colors(nodes.size()+1);
+  node_colors[0] = nodes.size();
+  for (unsigned int i = 0; i < nodes.size(); ++i)
+    {
+      node_colors[i+1] = (use_node_types ? node_types[nodes[i]] : 0);
+    }
+  key.insert(key.begin(), node_colors.begin(), node_colors.end());
+}
+
+void TSubgraph::project_key(const MotifKey& key, bool use_node_types, bool use_event_types,
+			    MotifKey& projected_key)
+{
+  projected_key = key;
+  unsigned int N = key[0];
+  if (!use_node_types)
+    {
+      for (unsigned int i = 1; i <= N; ++i) projected_key[i] = 0;
+    }
+  if (!use_event_types)
+    {
+      for (unsigned int j = N+3; j < projected_key.size(); j += 3) projected_key[j] = 1;
     }
-	
-  /* Calculate the canonical form. Note that permute() reserves memory
-     for a new Motif object. */
-  bliss::Stats stats;
-  return static_cast<Motif*>(g.permute(g.canonical_form(stats,NULL,NULL)));
 }
 
 Motif* TSubgraph::get_static_motif() const
@@ -127,11 +163,10 @@ Motif* TSubgraph::get_typed_motif() const
  * node in the motif (i.e. the smallest time window with which this
  * motif is valid).
  */
-bool TSubgraph::check_validity(const Events& events, const EventSet& eventSet)
+bool TSubgraph::check_validity(const Events& events, const EventVector& eventVector,
+			       EdgeVector& edgeVector)
 {
-  // prev_events[v] = iterator to the previous event of node in 'event_neighbors'
-  std::map<node_id, node_iterator> prev_events;
-  std::map<node_id, node_iterator>::iterator it;
+  edgeVector.resize(eventVector.size());
 
   /* We go through the events of each node in temporal order. If two
    * consecutive events in the subgraph are also consecutive in the
@@ -139,26 +174,23 @@ bool TSubgraph::check_validity(const Events& events, const EventSet& eventSet)
    * not makes no difference for the validity of the
    * subgraph. However, if they are not consecutive in the full data,
    * then the subgraph is valid only if the events in between are not
-   * in the same maximal subgraph.
+   * in the same maximal subgraph. The previous event of a node in the
+   * subgraph is found by going backwards in 'eventVector'; subgraphs
+   * are small, so this is faster than keeping a map.
    */
-  unsigned int i_ev = 0;
-  for (EventSet::const_iterator event_iter = eventSet.begin(); 
-       event_iter != eventSet.end(); ++event_iter)
+  for (unsigned int i_ev = 0; i_ev < eventVector.size(); ++i_ev)
     {
-      event_id curr = *event_iter;
+      event_id curr = eventVector[i_ev];
       Event const& e = events[curr];
 		
       node_id node = e.from();
       for (int i_node = 0; i_node < 2; i_node++)
 	{
-	  it = prev_events.find(node);
-	  if (it == prev_events.end())
-	    {
-	      prev_events[node] = events.find_node_event(node, curr);
-	    }   
-	  else
+	  unsigned int j = i_ev;
+	  while (j > 0 && events[eventVector[j-1]].from() != node && events[eventVector[j-1]].to() != node) --j;
+	  if (j > 0)
 	    {
-	      node_iterator uit(it->second);
+	      node_iterator uit(events.find_node_event(node, eventVector[j-1]));
 	      ++uit;
 				
 	      while (*uit != curr)
@@ -172,16 +204,40 @@ bool TSubgraph::check_validity(const Events& events, const EventSet& eventSet)
 		  if (events[*uit].component() == events[curr].component()) return false;
 		  ++uit;
 		}
-                    
-	      // Update previous event of this node.
-	      prev_events[node] = uit;
 	    }
 	  node = e.to(); // Change to the other node and repeat.
 	}
 
       // Check ok so far; update edgeVector and eventTypes.
       edgeVector[i_ev] = Edge(e);
-      ++i_ev;
+    }
+  return true;
+}
+
+bool TSubgraph::check_validity(const Events& events, const EventVector& eventVector,
+			       const ComponentHierarchy& ch, unsigned int i_tw)
+{
+  for (unsigned int i_ev = 0; i_ev < eventVector.size(); ++i_ev)
+    {
+      event_id curr = eventVector[i_ev];
+      event_id c_curr = ch.component(curr, i_tw);
+      Event const& e = events[curr];
+
+      node_id node = e.from();
+      for (int i_node = 0; i_node < 2; i_node++)
+	{
+	  unsigned int j = i_ev;
+	  while (j > 0 && events[eventVector[j-1]].from() != node && events[eventVector[j-1]].to() != node) --j;
+	  if (j > 0)
+	    {
+	      node_iterator uit(events.find_node_event(node, eventVector[j-1]));
+	      for (++uit; *uit != curr; ++uit)
+		{
+		  if (ch.component(*uit, i_tw) == c_curr) return false;
+		}
+	    }
+	  node = e.to(); // Change to the other node and repeat.
+	}
     }
   return true;
 }
@@ -192,16 +248,16 @@ void TSubgraph::create_node_and_edge_sets() const
   edgeSet.clear();
   for (EdgeVector::const_iterator it = edgeVector.begin(); it != edgeVector.end(); ++it)
     {
-      unsigned int v1 = it->to;
-      unsigned int v2 = it->from;
-      if (it->from < it->to)
+      unsigned int v1 = it->to();
+      unsigned int v2 = it->from();
+      if (it->from() < it->to())
 	{
-	  v1 = it->from;
-	  v2 = it->to;
+	  v1 = it->from();
+	  v2 = it->to();
 	}
       nodeSet.insert(v1);
       nodeSet.insert(v2);
-      edgeSet.insert(Edge(v1,v2,it->type));
+      edgeSet.insert(Edge(v1,v2,it->type()));
     }
 }
 
@@ -223,113 +279,313 @@ TSubgraphFinder::TSubgraphFinder(event_id root_event_id,
  :root_event_id(root_event_id),
   tw(time_window),
   max_subgraph_size(max_subgraph_size),
+  max_nodes(0),
+  max_edges(0),
   events(events),
   node_types(node_types),
-  subgraphs() {}
+  subgraphs(),
+  visitor(NULL),
+  eventVector(),
+  excludedEvents(),
+  validNeighbors(),
+  edges(),
+  violations(),
+  i_violations(0)
+{
+  // With a fixed maximum size the search state has a bounded size,
+  // so the buffers are allocated once here: each event has at most
+  // four immediate neighbors.
+  if (max_subgraph_size)
+    {
+      eventVector.reserve(max_subgraph_size);
+      edges.reserve(max_subgraph_size);
+      excludedEvents.reserve(4*max_subgraph_size);
+      validNeighbors.reserve(4*max_subgraph_size*max_subgraph_size);
+      violations.reserve(max_subgraph_size*max_subgraph_size);
+    }
+}
+
+
+void TSubgraphFinder::add_subgraph(unsigned int dt_max)
+{
+  //std::cerr << "      Adding subgraph " << subgraphs.size() << ": " << eventVector << " (dt_max = " << dt_max << ")\n";
+  if (visitor)
+    {
+      // Only valid subgraphs are added, so the edges can be
+      // constructed directly.
+      edges.resize(eventVector.size());
+      for (size_t i = 0; i < eventVector.size(); ++i) edges[i] = Edge(events[eventVector[i]]);
+      visitor->visit(eventVector, edges, dt_max);
+    }
+  else subgraphs.push_back(new TSubgraph(events, EventSet(eventVector.begin(), eventVector.end()),
+					 node_types, dt_max));
+}
+
+bool TSubgraphFinder::add_violations(size_t i_ev)
+{
+  event_id curr = eventVector[i_ev];
+  const Event& e = events[curr];
+
+  /* If the node has subgraph events both before and after the new
+     event, the events in between were already violations. New
+     violations only appear when the new event is the first or the
+     last subgraph event of the node. */
+  node_id node = e.from();
+  for (int i_node = 0; i_node < 2; i_node++)
+    {
+      size_t j = i_ev;
+      while (j > 0 && events[eventVector[j-1]].from() != node && events[eventVector[j-1]].to() != node) --j;
+      size_t k = i_ev+1;
+      while (k < eventVector.size() && events[eventVector[k]].from() != node && events[eventVector[k]].to() != node) ++k;
 
+      event_id first = Event::null_event, last = Event::null_event;
+      if (j > 0 && k == eventVector.size())
+	{
+	  first = eventVector[j-1]; last = curr;
+	}
+      else if (j == 0 && k < eventVector.size())
+	{
+	  first = curr; last = eventVector[k];
+	}
 
-void TSubgraphFinder::add_subgraph(const EventSet& eventSet, unsigned int dt_max)
+      if (first != Event::null_event)
+	{
+	  node_iterator uit(events.find_node_event(node, first));
+	  for (++uit; *uit != last; ++uit)
+	    {
+	      if (events[*uit].component() != events[root_event_id].component()) continue;
+	      if (is_excluded(*uit)) return false;
+	      if (std::find(violations.begin()+i_violations, violations.end(), *uit) == violations.end())
+		violations.push_back(*uit);
+	    }
+	}
+      node = e.to(); // Change to the other node and repeat.
+    }
+  return true;
+}
+
+bool TSubgraphFinder::is_within_limits() const
 {
-  //std::cerr << "      Adding subgraph " << subgraphs.size() << ": " << eventSet << " (dt_max = " << dt_max << ")\n";
-  subgraphs.push_back(new TSubgraph(events, eventSet, node_types, dt_max));
+  if (!max_nodes && !max_edges) return true;
+
+  // Subgraphs are small, so the nodes and edges are counted by
+  // comparing to the earlier events.
+  unsigned int n_nodes = 0, n_edges = 0;
+  for (size_t i = 0; i < eventVector.size(); ++i)
+    {
+      const Event& e = events[eventVector[i]];
+      bool new_from = true, new_to = true, new_edge = true;
+      for (size_t j = 0; j < i; ++j)
+	{
+	  const Event& f = events[eventVector[j]];
+	  if (f.from() == e.from() || f.to() == e.from()) new_from = false;
+	  if (f.from() == e.to() || f.to() == e.to()) new_to = false;
+	  if (f.type() == e.type() &&
+	      ((f.from() == e.from() && f.to() == e.to()) || (f.from() == e.to() && f.to() == e.from())))
+	    new_edge = false;
+	}
+      n_nodes += new_from + new_to;
+      n_edges += new_edge;
+    }
+  return ((!max_nodes || n_nodes <= max_nodes) && (!max_edges || n_edges <= max_edges));
 }
 
-void TSubgraphFinder::create_subgraphs(const EventSet& eventSet,
-				      const EventSet& excludedEvents,
-				      const EventMMap& validNeighbors,
-				      unsigned int dt_max)
+template <int Remaining>
+void TSubgraphFinder::create_subgraphs(size_t i_first, size_t i_end, size_t i_last, unsigned int dt_max)
 {
   /*
-  std::cerr << "    eventSet       : " << eventSet << std::endl;
+  std::cerr << "    eventVector    : " << eventVector << std::endl;
   std::cerr << "    excludedEvents : " << excludedEvents << std::endl;
-  std::cerr << "    validNeighbors : " << validNeighbors << std::endl;
   */
 
-  // Exclude all events that were already excluded (this includes the
-  // current event). This set will be updated with new events as they
-  // are added.
-  EventSet excludedEvents_new(excludedEvents);
-
-  // Go through the valid neighbors in the order of smallest time
-  // difference. Note that it is possible that an event is in
-  // validNeighbors twice if it can be reached via two different
-  // routes. The faster route will be used, and the event is added to
-  // excludedEvents, so this does not cause problems.
-  EventMMap::const_iterator it;
-  for (it = validNeighbors.begin(); it != validNeighbors.end(); ++it)
+  // Events excluded at this level are removed from the end of
+  // excludedEvents when returning.
+  size_t excluded_size = excludedEvents.size();
+
+  // Go through the valid neighbors validNeighbors[i_first, i_end)
+  // in the order of smallest time difference; the neighbors up to
+  // i_last remain valid in the recursion. Note that it is
+  // possible that an event is in validNeighbors twice if it can be
+  // reached via two different routes. The faster route will be used,
+  // and the event is added to excludedEvents, so this does not cause
+  // problems.
+  for (size_t i_nb = i_first; i_nb < i_end; ++i_nb)
     {
+      // Copy the neighbor, because validNeighbors may be reallocated
+      // in the recursion.
+      const Neighbor nb = validNeighbors[i_nb];
+
       // Make sure the event hasn't been added yet, and if not, add
       // the current event to the list of excluded events.
-      if (excludedEvents_new.find(it->second) != excludedEvents_new.end()) continue;
-      excludedEvents_new.insert(it->second);
+      if (is_excluded(nb.second)) continue;
+      excludedEvents.push_back(nb.second);
       
-      // Copy the previous event set, add the new event and construct
+      // Add the new event to the (sorted) event vector and construct
       // the corresponding motif.
-      EventSet eventSet_new(eventSet);
-      eventSet_new.insert(it->second);
-      dt_max = (it->first > dt_max ? it->first : dt_max);
-      add_subgraph(eventSet_new, dt_max);
+      size_t i_ev = std::upper_bound(eventVector.begin(), eventVector.end(), nb.second) - eventVector.begin();
+      eventVector.insert(eventVector.begin()+i_ev, nb.second);
+      dt_max = (nb.first > dt_max ? nb.first : dt_max);
+
+      // Save the violations of the new subgraph after those of the
+      // current one. The branch is cut if a violation can no longer
+      // be added, if there are more violations than room for new
+      // events, or if the subgraph has too many nodes or edges.
+      size_t v_first = i_violations, v_last = violations.size();
+      bool can_be_valid = is_within_limits();
+      for (size_t i = v_first; i < v_last && can_be_valid; ++i)
+	{
+	  event_id v = violations[i];
+	  if (v == nb.second) continue;
+	  if (is_excluded(v)) can_be_valid = false;
+	  violations.push_back(v);
+	}
+      i_violations = v_last;
+      if (can_be_valid) can_be_valid = add_violations(i_ev);
+      if (can_be_valid && Remaining >= 0)
+	can_be_valid = (violations.size() - i_violations <= (size_t)Remaining - 1);
+      else if (can_be_valid && max_subgraph_size != 0)
+	can_be_valid = (violations.size() - i_violations <= max_subgraph_size - eventVector.size());
+
+      if (can_be_valid && i_violations == violations.size()) add_subgraph(dt_max);
 	      
       // Continue recursion if the maximum subgraph size has not been reached.
-      if (max_subgraph_size == 0 || eventSet_new.size() < max_subgraph_size)
+      if (can_be_valid && (Remaining >= 0 ? Remaining > 1 :
+			   (max_subgraph_size == 0 || eventVector.size() < max_subgraph_size)))
 	{
 	  // Valid neighbors are immediate neighbors of the current
 	  // event that either were valid before and have a time
 	  // difference larger (or possibly equal) than for the
-	  // current event,
-	  EventMMap::const_iterator it2(it);
-	  EventMMap validNeighbors_new(++it2, validNeighbors.end());
-	  // ... or are valid neighbors of the newly added event, take
-	  // place after the root event, have not been excluded so far
-	  // and have a time difference smaller than the time window:
-	  EventMMap potentialNeighbors;
-	  events.prev_immediate_events(it->second, potentialNeighbors);
-	  events.next_immediate_events(it->second, potentialNeighbors);
-	  for (EventMMap::const_iterator pnit = potentialNeighbors.begin();
+	  // current event, or are valid neighbors of the newly added
+	  // event, take place after the root event, have not been
+	  // excluded so far and have a time difference smaller than
+	  // the time window. The two sorted lists are merged to the
+	  // end of validNeighbors, old neighbors first when the time
+	  // differences are equal.
+	  ImmediateEvents potentialNeighbors, newNeighbors;
+	  events.prev_immediate_events(nb.second, potentialNeighbors);
+	  events.next_immediate_events(nb.second, potentialNeighbors);
+	  for (ImmediateEvents::const_iterator pnit = potentialNeighbors.begin();
 	       pnit != potentialNeighbors.end(); ++pnit)
 	    {
-	      if ((pnit->second > root_event_id) && 
-		  (excludedEvents_new.find(pnit->second) == excludedEvents_new.end()) &&
-		  pnit->first <= tw)
+	      if ((pnit->second > root_event_id) && !is_excluded(pnit->second) && pnit->first <= tw)
+		{
+		  newNeighbors.insert(*pnit);
+		}
+	    }
+
+	  size_t i_new_first = validNeighbors.size();
+	  size_t i_old = i_nb+1;
+	  ImmediateEvents::const_iterator new_it = newNeighbors.begin();
+	  while (i_old < i_last || new_it != newNeighbors.end())
+	    {
+	      if (new_it == newNeighbors.end() || (i_old < i_last && validNeighbors[i_old].first <= new_it->first))
 		{
-		  validNeighbors_new.insert(*pnit);
+		  validNeighbors.push_back(validNeighbors[i_old]); ++i_old;
+		}
+	      else
+		{
+		  validNeighbors.push_back(*new_it); ++new_it;
 		}
 	    }
 
 	  // Continue recursion.
-	  create_subgraphs(eventSet_new, excludedEvents_new, validNeighbors_new, dt_max);
+	  create_subgraphs<(Remaining >= 0 ? Remaining-1 : -1)>(i_new_first, validNeighbors.size(),
+								validNeighbors.size(), dt_max);
+	  validNeighbors.resize(i_new_first);
 	}
+
+      violations.resize(v_last);
+      i_violations = v_first;
+      eventVector.erase(eventVector.begin()+i_ev);
     }	
+
+  excludedEvents.resize(excluded_size);
 }
 
-void TSubgraphFinder::find_subgraphs()
+void TSubgraphFinder::init_search()
 {
   // Events in the subgraph; initially only root event.
-  EventSet eventSet;
-  eventSet.insert(root_event_id);
+  eventVector.clear();
+  eventVector.push_back(root_event_id);
 
-  // Construct the motif that consists of only this one event.
-  add_subgraph(eventSet,0);
-  
   // Put the root event to excluded events so it is no longer added.
-  EventSet excludedEvents;
-  excludedEvents.insert(root_event_id);
+  excludedEvents.clear();
+  excludedEvents.push_back(root_event_id);
+
+  // A single event is always valid.
+  violations.clear();
+  i_violations = 0;
 
   // Place the next events of both nodes that occur within tw into
   // validneighbors (not previous events, because we only return those
   // subgraphs where the root event is the first event.)
-  
-  // First get all valid neighbors ...
-  EventMMap validNeighbors;
-  events.next_immediate_events(root_event_id, validNeighbors);
-  // ... and then cut out the part where the time differences are too big.
-  EventMMap::iterator it = validNeighbors.begin();
-  for (; it != validNeighbors.end(); ++it) if (it->first > tw) break;
-  if (it != validNeighbors.end()) validNeighbors.erase(it, validNeighbors.end());
+  ImmediateEvents nextEvents;
+  events.next_immediate_events(root_event_id, nextEvents);
+  validNeighbors.clear();
+  for (ImmediateEvents::const_iterator it = nextEvents.begin(); it != nextEvents.end(); ++it)
+    {
+      if (it->first > tw) break;
+      validNeighbors.push_back(*it);
+    }
+}
+
+void TSubgraphFinder::search(size_t i_first, size_t i_end)
+{
+  size_t i_last = validNeighbors.size();
+  switch (max_subgraph_size)
+    {
+    case 2: create_subgraphs<1>(i_first, i_end, i_last, 0); break;
+    case 3: create_subgraphs<2>(i_first, i_end, i_last, 0); break;
+    case 4: create_subgraphs<3>(i_first, i_end, i_last, 0); break;
+    case 5: create_subgraphs<4>(i_first, i_end, i_last, 0); break;
+    case 6: create_subgraphs<5>(i_first, i_end, i_last, 0); break;
+    case 7: create_subgraphs<6>(i_first, i_end, i_last, 0); break;
+    case 8: create_subgraphs<7>(i_first, i_end, i_last, 0); break;
+    default: create_subgraphs<-1>(i_first, i_end, i_last, 0);
+    }
+}
+
+void TSubgraphFinder::find_subgraphs()
+{
+  init_search();
+
+  // Construct the motif that consists of only the root event, unless
+  // even it has too many nodes or edges.
+  if (is_within_limits()) add_subgraph(0);
 
   // Create subgraphs recursively.
-  create_subgraphs(eventSet, excludedEvents, validNeighbors, 0);
+  search(0, validNeighbors.size());
+}
+
+void TSubgraphFinder::find_subgraphs(TSubgraphVisitor& visitor)
+{
+  this->visitor = &visitor;
+  find_subgraphs();
+  this->visitor = NULL;
+}
 
+void TSubgraphFinder::find_subgraphs(event_id root_event_id, TSubgraphVisitor& visitor)
+{
+  this->root_event_id = root_event_id;
+  find_subgraphs(visitor);
+}
+
+void TSubgraphFinder::find_subgraphs(event_id root_event_id, unsigned int i_branch,
+				     TSubgraphVisitor& visitor)
+{
+  this->root_event_id = root_event_id;
+  this->visitor = &visitor;
+  init_search();
+
+  if (i_branch == 0 && is_within_limits()) add_subgraph(0);
+  if (i_branch < validNeighbors.size())
+    {
+      // The earlier branches have excluded their first events.
+      for (size_t i_nb = 0; i_nb < i_branch; ++i_nb)
+	excludedEvents.push_back(validNeighbors[i_nb].second);
+      search(i_branch, i_branch+1);
+    }
+  this->visitor = NULL;
 }
 
 TSubgraphFinder::~TSubgraphFinder()
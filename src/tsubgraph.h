@@ -12,14 +12,20 @@
 #include <set>
 #include <map>
 #include <queue>
+#include <algorithm>
 #include "motif.h"
 #include "edges.h"
 
 class Events;
 
 typedef std::set<event_id> EventSet;
+typedef std::vector<event_id> EventVector;
 typedef std::set<node_id> NodeSet;
 
+/* Canonical encoding of a temporal motif (see
+   TSubgraph::get_labelled_key()). */
+typedef std::vector<unsigned int> MotifKey;
+
 /* Temporal subgraph consists of an ordered sequence of edges. The
    edges may repeat (multiple events on the same edge)
 
@@ -45,14 +51,6 @@ class TSubgraph
   /* Methods for constructing the set of nodes and edges. */
   void create_node_and_edge_sets() const;
 
-  // Make sure the subgraph is valid. Also constructs edgeVector.
-  bool check_validity(const Events& events, const EventSet& eventSet);
-
-  // Auxiliary method for constructing motifs.
-  unsigned int add_event_to_motif(Motif& g, node_id fr, node_id to, int prev_ge_id,
-				  std::map<node_id, unsigned int>& nodeMap,
-				  unsigned int e_type, unsigned int fr_type, unsigned int to_type,
-				  bool is_static) const;
   
  public:
 
@@ -77,6 +75,11 @@ class TSubgraph
   /* Delete pointers to motifs. */
   ~TSubgraph();
 
+  /* Build the motif graph in 'c' and find its canonical
+     labelling. The identity and the canonical form of the motif are
+     then given by c.get_id() and c.get_motif(). */
+  void canonize(MotifCanonizer& c, bool use_node_types, bool use_event_types, bool is_static) const;
+
   // Return motif.
   Motif* get_motif(bool use_node_types, bool use_event_types, bool is_static) const;
   // Shortcuts:
@@ -84,6 +87,33 @@ class TSubgraph
   Motif* get_untyped_motif() const;
   Motif* get_static_motif() const;
 
+  /* Get a canonical key of the (non-static) motif without
+     constructing it. Because the events are in temporal order, the
+     only isomorphism between two motifs maps the i'th event to the
+     i'th event, so relabelling the nodes in the order of first
+     appearance (the source node of an event before the target node)
+     gives a canonical form. The key is
+
+        N c_0 ... c_{N-1} fr_1 to_1 t_1 ... fr_k to_k t_k
+
+     where N is the number of nodes, c_i are the node colors and fr,
+     to and t give each event by the new node labels and its
+     color. The key identifies the same motifs as the canonical graph
+     only if no node has the same color as an event; otherwise bliss
+     could map node vertices to event vertices and give the same
+     canonical graph for two different keys. The main program warns
+     about such types. */
+  void get_labelled_key(bool use_node_types, bool use_event_types, MotifKey& key) const;
+
+  /* Get the key of the motif with node or event types left out from
+     the key of the typed motif. Relabelling the nodes does not depend
+     on the colors, so this gives the same key as
+     get_labelled_key(use_node_types, use_event_types), and a single
+     labelling gives the keys of both the typed and the projected
+     motif. */
+  static void project_key(const MotifKey& key, bool use_node_types, bool use_event_types,
+			  MotifKey& projected_key);
+
   /* Get the number of events in the most recently returned
      motif. */
   inline unsigned int nof_events() const { return edgeVector.size(); };
@@ -110,6 +140,17 @@ class TSubgraph
 
   inline unsigned int dt_max() const { return __dt_max; };
 
+  /* Make sure the subgraph given by the events in 'eventVector'
+     (in temporal order) is valid. Also constructs the corresponding
+     edge vector. */
+  static bool check_validity(const Events& events, const EventVector& eventVector,
+			     EdgeVector& edgeVector);
+
+  /* Same as above, but use the maximal subgraphs with time window
+     ch.time_window(i_tw) instead of the component ids of events. */
+  static bool check_validity(const Events& events, const EventVector& eventVector,
+			     const ComponentHierarchy& ch, unsigned int i_tw);
+
   /* Build a set of event types. */
   //inline void build_event_type_set(std::set<short int>& evt) const { evt.insert(eventTypes.begin(), eventTypes.end());};
     
@@ -117,11 +158,24 @@ class TSubgraph
 
 typedef std::list<TSubgraph*> TSubgraphList;
 
+/* Interface for receiving valid subgraphs while they are being
+   found. The events (in temporal order) and the corresponding edges
+   are only valid during the call to visit(). */
+class TSubgraphVisitor
+{
+ public:
+  virtual void visit(const EventVector& eventVector, const EdgeVector& edges,
+		     unsigned int dt_max) =0;
+  virtual ~TSubgraphVisitor() {};
+};
+
 class TSubgraphFinder
 {
  private:
+  typedef std::pair<unsigned int, event_id> Neighbor;
+
   /* The event where the search is started. */
-  const event_id root_event_id;
+  event_id root_event_id;
 	
   /* Time window. */
   const unsigned int tw;
@@ -130,6 +184,11 @@ class TSubgraphFinder
      to 0, all submotifs will be searched (which might take a
      while).*/
   unsigned int max_subgraph_size;
+
+  /* The maximum number of nodes and edges in subgraphs (0 for no
+     limit). Edges are counted like in TSubgraph::nof_edges(). */
+  unsigned int max_nodes;
+  unsigned int max_edges;
 	
   /* Reference to the events object where this motif is to be
      found. */
@@ -141,6 +200,45 @@ class TSubgraphFinder
   /* Subgraphs (event sets) where root_event_id is the first
      one. */
   TSubgraphList subgraphs;
+
+  /* If set, valid subgraphs are given to the visitor instead of
+     being saved in 'subgraphs'. */
+  TSubgraphVisitor* visitor;
+
+  /* State of the recursive search. These are shared by all levels
+     of the recursion: each level adds to the end and removes what it
+     added before returning, so the memory is reused for all
+     subgraphs and all root events.
+
+     eventVector: events in the current subgraph in temporal order.
+     excludedEvents: events that can no longer be added.
+     validNeighbors: (time difference, event) pairs that can be
+        added, sorted by time difference. Each level of the recursion
+        uses a range at the end of the vector.
+  */
+  EventVector eventVector;
+  EventVector excludedEvents;
+  std::vector<Neighbor> validNeighbors;
+  EdgeVector edges; // Reused for the edges of each subgraph.
+
+  /* Events that make the current subgraph invalid: events of the
+     same maximal subgraph as the root event that take place between
+     two consecutive subgraph events of a node. Adding an event to the
+     subgraph can only remove that event from this set, so the
+     subgraph can become valid only if all of them are added later.
+     If the component ids of events have been set with a smaller time
+     window than the one used here, an empty set is only a necessary
+     condition for validity with the larger windows. The set of the
+     current subgraph is violations[i_violations, end), and each
+     level of the recursion saves its set after that of the previous
+     level. */
+  EventVector violations;
+  size_t i_violations;
+
+  inline bool is_excluded(event_id e) const
+  {
+    return std::find(excludedEvents.begin(), excludedEvents.end(), e) != excludedEvents.end();
+  };
 	
   /* Find all motifs corresponding to valid subgraphs up to size
    * `max_subgraph_size` where the root event is the first
@@ -149,11 +247,33 @@ class TSubgraphFinder
    * takes care of the recursive search.
    */
   void find_subgraphs();
-  void create_subgraphs(const EventSet& eventMap,
-			const EventSet& excludedEvents,
-			const EventMMap& validNeighbors,
-			unsigned int dt_max);
-  void add_subgraph(const EventSet& eventMap, unsigned int dt_max);
+  void add_subgraph(unsigned int dt_max);
+
+  /* Search the first-level branches validNeighbors[i_first, i_end)
+     with the version of create_subgraphs() selected by the maximum
+     subgraph size. */
+  void search(size_t i_first, size_t i_end);
+
+  /* 'Remaining' is the number of events that can still be added to
+     the subgraph, including the one added at this level, for maximum
+     sizes up to 8; the depth checks are then resolved at compile
+     time. With -1 the size is checked against max_subgraph_size. */
+  template <int Remaining>
+  void create_subgraphs(size_t i_first, size_t i_end, size_t i_last, unsigned int dt_max);
+
+  /* Initialize the search state for the current root event. */
+  void init_search();
+
+  /* Check that the current subgraph does not have more nodes or
+     edges than allowed. Because adding events can only increase
+     these, branches that exceed the limits are not grown further. */
+  bool is_within_limits() const;
+
+  /* Add the violations caused by the event eventVector[i_ev] to the
+     end of 'violations'. Returns false if any violation is an
+     excluded event, in which case no valid subgraph can be reached by
+     adding more events. */
+  bool add_violations(size_t i_ev);
 	
  public:
   /* Simple constructor, only initializes parameters. */
@@ -162,9 +282,36 @@ class TSubgraphFinder
 		 unsigned int max_submotif_size,
 		 Events const& events,
 		 std::vector<unsigned short int> const& node_types);
+
+  /* Limit the number of nodes and edges in subgraphs. 0 means no
+     limit. */
+  inline void set_limits(unsigned int max_nodes, unsigned int max_edges)
+  {
+    this->max_nodes = max_nodes;
+    this->max_edges = max_edges;
+  };
+
+  /* Find all subgraphs and give the valid ones to 'visitor' during
+     the search. No subgraph objects are created. */
+  void find_subgraphs(TSubgraphVisitor& visitor);
+
+  /* Same as above, but first change the root event. This allows
+     using the same finder (and its memory) for all root events. */
+  void find_subgraphs(event_id root_event_id, TSubgraphVisitor& visitor);
+
+  /* The search from a root event can be split into independent
+     branches by the first event added after the root event (the
+     next event of either node). Branch 'i_branch' gives the same
+     subgraphs as the i_branch'th iteration of the full search, and
+     the single-event subgraph is included in branch 0. Together the
+     branches 0, ..., max_branches-1 give all subgraphs of the root
+     event; branches that do not exist give no subgraphs. */
+  static const unsigned int max_branches = 2;
+  void find_subgraphs(event_id root_event_id, unsigned int i_branch,
+		      TSubgraphVisitor& visitor);
 	
   /* Methods for iterating through subgraphs. This actually
-     first finds all subgraphs and saves them into a list. The
+     first finds all valid subgraphs and saves them into a list. The
      pointers to the subgraphs are owned by the subgraph finder,
      and they will be deleted when the finder object goes out of
      scope. */
@@ -0,0 +1,12 @@
+#!/bin/bash
+prog="../bin/test_motifs"
+
+if [ ! -e "${prog}" ]; then
+    echo "Error: Program file '${prog}' does not exist."
+    echo "Please run 'make test_motifs' in directory '../src'."
+    exit 1
+fi
+
+# Run all tests of motif identification. The exit status is non-zero
+# if some test fails.
+${prog}